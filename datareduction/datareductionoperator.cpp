@@ -27,6 +27,7 @@
 #include <array>
 #include "datareductionoperator.h"
 #include "../object_wrapper.h"
+#include "../vlasovsolver/cpu_block_content.hpp"
 
 using namespace std;
 
@@ -751,9 +752,7 @@ namespace DRO {
 
          #pragma omp for
          for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-	    for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
-	       threadMax = max((Real)(block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]), threadMax);
-            }
+            threadMax = max((Real)blockMaxValue(block_data + n * SIZE_VELBLOCK), threadMax);
          }
 
          #pragma omp critical
@@ -67,6 +67,15 @@ namespace geometry {
    };
 }
 
+/** Reconstruction used in the semi-Lagrangian acceleration.*/
+namespace accReconstruction {
+   enum Order {
+      PLM,             /**< Piecewise linear, 2nd order.*/
+      PPM,             /**< Piecewise parabolic, 3rd order.*/
+      PQM              /**< Piecewise quartic, 5th order (default).*/
+   };
+}
+
 namespace vmesh {
    #ifndef VAMR
    typedef uint32_t GlobalID;              /**< Datatype used for velocity block global IDs.*/
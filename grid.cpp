@@ -303,8 +303,9 @@ void initializeGrids(
             validateMesh(mpiGrid,popID);
          #endif
 
-         // set initial LB metric based on number of blocks, all others
-         // will be based on time spent in acceleration
+         // set initial LB metric based on number of blocks, later ones are
+         // measured in translation and acceleration and converted to blocks
+         // by normalizeLoadBalanceWeights
          #pragma omp parallel for schedule(static)
          for (size_t i=0; i<cells.size(); ++i) {
             mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] += mpiGrid[cells[i]]->get_number_of_velocity_blocks(popID);
@@ -645,13 +646,37 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
       setFaceNeighborRanks( mpiGrid );
    }
 
-   // Prepare cellIDs and pencils for AMR translation
+   // The partition changed, pencils for AMR translation are rebuilt before the next translation
    if(P::amrMaxSpatialRefLevel > 0) {
-      phiprof::Timer timer {"GetSeedIdsAndBuildPencils"};
-      for (int dimension=0; dimension<3; dimension++) {
-         prepareSeedIdsAndPencils(mpiGrid,dimension);
+      invalidatePencils();
+   }
+}
+
+/*
+  Convert the load balance weights measured in translation and acceleration
+  from ns to blocks.
+
+  Further documentation in grid.h
+*/
+void normalizeLoadBalanceWeights(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+   const vector<CellID>& cells = getLocalCells();
+   Real sums[2] = {0.0, 0.0}; // weight, blocks
+   for (size_t c=0; c<cells.size(); ++c) {
+      sums[0] += mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER];
+      for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         sums[1] += mpiGrid[cells[c]]->get_number_of_velocity_blocks(popID);
       }
    }
+   MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+   if (sums[0] <= 0.0) {
+      return;
+   }
+
+   // Global cost of one block is one
+   const Real blocksPerNs = sums[1] / sums[0];
+   for (size_t c=0; c<cells.size(); ++c) {
+      mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] *= blocksPerNs;
+   }
 }
 
 /*
@@ -1540,6 +1565,7 @@ bool adaptRefinement(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGri
 
    recalculateLocalCellsCache();
    initSpatialCellCoordinates(mpiGrid);
+   invalidatePencils();
 
    SpatialCell::set_mpi_transfer_type(Transfer::CELL_DIMENSIONS);
    mpiGrid.update_copies_of_remote_neighbors(SYSBOUNDARIES_NEIGHBORHOOD_ID);
@@ -56,6 +56,19 @@ void initializeGrids(
 */
 void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, SysBoundary& sysBoundaries);
 
+/*!
+  \brief Convert the load balance weights of the local cells from ns to blocks
+
+  Translation and acceleration add the measured time of each cell in ns to
+  LBWEIGHTCOUNTER on the step before a rebalance. The weights are scaled so
+  that their global sum equals the global number of blocks, which is the
+  unit of the weights set at initialization, after failed refinement and
+  read from restart files.
+
+    \param[in,out] mpiGrid The DCCRG grid with spatial cells
+*/
+void normalizeLoadBalanceWeights(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+
 /*!
 
 Updates velocity block lists between remote neighbors and
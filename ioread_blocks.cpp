@@ -0,0 +1,453 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <list>
+
+#include "ioread_blocks.h"
+#include "logger.h"
+#include "mpiconversion.h"
+#include "object_wrapper.h"
+
+using namespace std;
+
+extern Logger logFile;
+
+/*!
+ \brief Read cell ID's
+ Read in cell ID's from file. Note: Uses the newer version of vlsv parallel reader
+ \param file Some vlsv reader with a file open
+ \param fileCells Vector in whic to store the cell ids
+ \param masterRank The simulation's master rank id (Vlasiator uses 0, which should be the default)
+ \param comm MPI comm (MPI_COMM_WORLD should be the default)
+*/
+bool readCellIds(vlsv::ParallelReader & file, vector<CellID>& fileCells, const int masterRank,MPI_Comm comm)
+{
+   // Get info on array containing cell Ids:
+   uint64_t arraySize = 0;
+   uint64_t vectorSize;
+   vlsv::datatype::type dataType;
+   uint64_t byteSize;
+   list<pair<string,string> > attribs;
+   bool success=true;
+   int rank;
+   MPI_Comm_rank(comm,&rank);
+   if (rank==masterRank) {
+      const short int readFromFirstIndex = 0;
+      //let's let master read cellId's, we anyway have at max ~1e6 cells
+      attribs.push_back(make_pair("name","CellID"));
+      attribs.push_back(make_pair("mesh","SpatialGrid"));
+      if (file.getArrayInfoMaster("VARIABLE",attribs,arraySize,vectorSize,dataType,byteSize) == false) {
+         logFile << "(RESTART) ERROR: Failed to read cell ID array info!" << endl << write;
+         return false;
+      }
+
+      //Make a routine error check:
+      if( vectorSize != 1 ) {
+         logFile << "(RESTART) ERROR: Bad vectorsize at " << __FILE__ << " " << __LINE__ << endl << write;
+         return false;
+      }
+      
+      //   Read cell Ids:
+      char* IDbuffer = new char[arraySize*vectorSize*byteSize];
+      if (file.readArrayMaster("VARIABLE",attribs,readFromFirstIndex,arraySize,IDbuffer) == false) {
+         logFile << "(RESTART) ERROR: Failed to read cell Ids!" << endl << write;
+         success = false;
+      }
+   
+   // Convert global Ids into our local DCCRG 64 bit uints
+      const uint64_t& numberOfCells = arraySize;
+      fileCells.resize(numberOfCells);
+      if (dataType == vlsv::datatype::type::UINT && byteSize == 4) {
+         uint32_t* ptr = reinterpret_cast<uint32_t*>(IDbuffer);
+         //Input cell ids
+         for (uint64_t i=0; i<numberOfCells; ++i) {
+            const CellID cellID = ptr[i];
+            fileCells[i] = cellID;
+         }
+      } else if (dataType == vlsv::datatype::type::UINT && byteSize == 8) {
+         uint64_t* ptr = reinterpret_cast<uint64_t*>(IDbuffer);
+         for (uint64_t i=0; i<numberOfCells; ++i) {
+            const CellID cellID = ptr[i];
+            fileCells[i] = cellID;
+         }
+      } else {
+         logFile << "(RESTART) ERROR: ParallelReader returned an unsupported datatype for cell Ids!" << endl << write;
+         success = false;
+      }
+      delete[] IDbuffer;
+   }
+
+   //broadcast cellId's to everybody
+   MPI_Bcast(&arraySize,1,MPI_UINT64_T,masterRank,comm);   
+   fileCells.resize(arraySize);
+   MPI_Bcast(&(fileCells[0]),arraySize,MPI_UINT64_T,masterRank,comm);
+
+   return success;
+}
+
+/** Read velocity block mesh data and distribution function data belonging to this process 
+ * for the given particle species. This function must be called simultaneously by all processes.
+ * @param file VLSV reader with input file open.
+ * @param spatMeshName Name of the spatial mesh.
+ * @param fileCells List of all spatial cell IDs.
+ * @param localCellStartOffset The offset from which to start reading cells.
+ * @param localCells How many spatial cells after the offset to read.
+ * @param blocksPerCell Number of velocity blocks for this particle species in each spatial cell belonging to this process.
+ * @param localBlockStartOffset Offset into velocity block data arrays from which to start reading data.
+ * @param localBlocks Number of velocity blocks for this species assigned to this process.
+ * @param getCell Function returning the spatial cell with the given ID, all cells read by this process must exist.
+ * @param popID ID of the particle species who's data is to be read.
+ * @return If true, velocity block data was read successfully.*/
+template <typename fileReal>
+bool _readBlockData(
+   vlsv::ParallelReader & file,
+   const std::string& spatMeshName,
+   const std::vector<uint64_t>& fileCells,
+   const uint64_t localCellStartOffset,
+   const uint64_t localCells,
+   const vmesh::LocalID* blocksPerCell,
+   const uint64_t localBlockStartOffset,
+   const uint64_t localBlocks,
+   const std::function<SpatialCell*(const CellID&)>& getCell,
+   std::function<vmesh::GlobalID(vmesh::GlobalID)> blockIDremapper,
+   const uint popID
+) {   
+   uint64_t arraySize;
+   uint64_t avgVectorSize;
+   vlsv::datatype::type dataType;
+   uint64_t byteSize;
+   list<pair<string,string> > avgAttribs;
+   bool success=true;
+   const string popName = getObjectWrapper().particleSpecies[popID].name;
+   const string tagName = "BLOCKIDS";
+   
+   avgAttribs.push_back(make_pair("mesh",spatMeshName));
+   avgAttribs.push_back(make_pair("name",popName));
+   
+    //Get block id array info and store them into blockIdAttribs, lockIdByteSize, blockIdDataType, blockIdVectorSize
+  list<pair<string,string> > blockIdAttribs;
+  uint64_t blockIdVectorSize, blockIdByteSize;
+  vlsv::datatype::type blockIdDataType;
+  blockIdAttribs.push_back( make_pair("mesh", spatMeshName));
+  blockIdAttribs.push_back( make_pair("name", popName));
+  if (file.getArrayInfo("BLOCKIDS",blockIdAttribs,arraySize,blockIdVectorSize,blockIdDataType,blockIdByteSize) == false ){
+    logFile << "(RESTART) ERROR: Failed to read BLOCKCOORDINATES array info " << endl << write;
+    return false;
+  }
+  if(file.getArrayInfo("BLOCKVARIABLE",avgAttribs,arraySize,avgVectorSize,dataType,byteSize) == false ){
+    logFile << "(RESTART) ERROR: Failed to read BLOCKVARIABLE array info " << endl << write;
+    return false;
+  }
+
+   //Some routine error checks:
+   if( avgVectorSize!=WID3 ){
+      logFile << "(RESTART) ERROR: Blocksize does not match in restart file " << endl << write;
+      return false;
+   }
+   if( byteSize != sizeof(fileReal) ) {
+      logFile << "(RESTART) ERROR: Bad avgs bytesize at " << __FILE__ << " " << __LINE__ << endl << write;
+      return false;
+   }
+   
+   if( blockIdByteSize != sizeof(vmesh::GlobalID)) {
+      logFile << "(RESTART) ERROR: BlockID data size does not match " << __FILE__ << " " << __LINE__ << endl << write;
+      return false;
+   }
+
+   fileReal* avgBuffer = new fileReal[avgVectorSize * localBlocks]; //avgs data for all cells
+   vmesh::GlobalID * blockIdBuffer = new vmesh::GlobalID[blockIdVectorSize * localBlocks]; //blockids of all cells
+
+   //Read block ids and data
+   if (file.readArray("BLOCKIDS", blockIdAttribs, localBlockStartOffset, localBlocks, (char*)blockIdBuffer ) == false) {
+      cerr << "ERROR, failed to read BLOCKIDS in " << __FILE__ << ":" << __LINE__ << endl;
+      success = false;
+   }
+   if (file.readArray("BLOCKVARIABLE", avgAttribs, localBlockStartOffset, localBlocks, (char*)avgBuffer) == false) {
+      cerr << "ERROR, failed to read BLOCKVARIABLE in " << __FILE__ << ":" << __LINE__ << endl;
+      success = false;
+   }
+   
+   uint64_t blockBufferOffset=0;
+   //Go through all spatial cells     
+   vector<vmesh::GlobalID> blockIdsInCell; //blockIds in a particular cell, temporary usage
+   for(uint64_t i=0; i<localCells; i++) {
+      CellID cell = fileCells[localCellStartOffset + i]; //spatial cell id 
+      vmesh::LocalID nBlocksInCell = blocksPerCell[i];
+      //copy blocks in this cell to vector blockIdsInCell, size of read in data has been checked earlier
+      blockIdsInCell.reserve(nBlocksInCell);
+      blockIdsInCell.assign(blockIdBuffer + blockBufferOffset, blockIdBuffer + blockBufferOffset + nBlocksInCell);
+      for(auto& id : blockIdsInCell) {
+         id = blockIDremapper(id);
+      }
+      getCell(cell)->add_velocity_blocks(blockIdsInCell,popID); //allocate space for all blocks and create them
+      //copy avgs data, here a conversion may happen between float and double
+      Realf *cellBlockData=getCell(cell)->get_data(popID);
+      for(uint64_t i = 0; i< WID3 * nBlocksInCell ; i++){
+         cellBlockData[i] =  avgBuffer[blockBufferOffset*WID3 + i];
+      }
+      blockBufferOffset += nBlocksInCell; //jump to location of next local cell
+   }
+
+   delete[] avgBuffer;
+   delete[] blockIdBuffer;
+   return success;
+}
+
+/** Read velocity block data of all existing particle species.
+ * @param file VLSV reader.
+ * @param meshName Name of the spatial mesh.
+ * @param fileCells Vector containing spatial cell IDs.
+ * @param localCellStartOffset Offset into fileCells, determines where the cells belonging 
+ * to this process start.
+ * @param localCells Number of spatial cells assigned to this process.
+ * @param getCell Function returning the spatial cell with the given ID, all cells read by this process must exist.
+ * @return If true, velocity block data was read successfully.*/
+bool readBlockData(
+        vlsv::ParallelReader& file,
+        const string& meshName,
+        const vector<CellID>& fileCells,
+        const uint64_t localCellStartOffset,
+        const uint64_t localCells,
+        const std::function<SpatialCell*(const CellID&)>& getCell
+   ) {
+   bool success = true;
+
+   const uint64_t bytesReadStart = file.getBytesRead();
+   int myRank,N_processes;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   MPI_Comm_size(MPI_COMM_WORLD,&N_processes);
+
+   uint64_t arraySize;
+   uint64_t vectorSize;
+   vlsv::datatype::type dataType;
+   uint64_t byteSize;
+   uint64_t* offsetArray = new uint64_t[N_processes];
+
+   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+      const string& popName = getObjectWrapper().particleSpecies[popID].name;
+
+      // Create a cellID remapping lambda that can renumber our velocity space, should it's size have changed.
+      // By default, this is a no-op that keeps the blockIDs untouched.
+      std::function<vmesh::GlobalID(vmesh::GlobalID)> blockIDremapper = [](vmesh::GlobalID oldID) -> vmesh::GlobalID {return oldID;};
+
+      // Check that velocity space extents and DV matches the grids we have created
+      list<pair<string,string> > attribs;
+      attribs.push_back(make_pair("mesh",popName));
+      std::array<unsigned int, 6> fileMeshBBox;
+      unsigned int* bufferpointer = &fileMeshBBox[0];
+      if (file.read("MESH_BBOX",attribs,0,6,bufferpointer,false) == false) {
+         logFile << "(RESTART) ERROR: Failed to read MESH_BBOX at " << __FILE__ << ":" << __LINE__ << endl << write;
+         success = false;
+      }
+
+      const size_t meshID = getObjectWrapper().particleSpecies[popID].velocityMesh;
+      const vmesh::MeshParameters& ourMeshParams = getObjectWrapper().velocityMeshes[meshID];
+      if(fileMeshBBox[0] != ourMeshParams.gridLength[0] ||
+            fileMeshBBox[1] != ourMeshParams.gridLength[1] ||
+            fileMeshBBox[2] != ourMeshParams.gridLength[2]) {
+
+         logFile << "(RESTART) INFO: velocity mesh sizes don't match:" << endl
+                 << "    restart file has " << fileMeshBBox[0] << " x " << fileMeshBBox[1] << " x " << fileMeshBBox[2] << "," << endl
+                 << "    config specifies " << ourMeshParams.gridLength[0] << " x " <<  ourMeshParams.gridLength[1] << " x " <<  ourMeshParams.gridLength[2] << endl << write;
+
+         if(ourMeshParams.gridLength[0] < fileMeshBBox[0] ||
+               ourMeshParams.gridLength[1] < fileMeshBBox[1] ||
+               ourMeshParams.gridLength[2] < fileMeshBBox[2]) {
+            logFile << "(RESTART) ERROR: trying to shrink velocity space." << endl << write;
+            abort();
+         }
+
+         // If we are mismatched, we have to iterate through the velocity coords to see if we have a
+         // chance at renumbering.
+         std::vector<Real> fileVelCoordsX(fileMeshBBox[0]*fileMeshBBox[3]+1);
+         std::vector<Real> fileVelCoordsY(fileMeshBBox[1]*fileMeshBBox[4]+1);
+         std::vector<Real> fileVelCoordsZ(fileMeshBBox[2]*fileMeshBBox[5]+1);
+
+         Real* tempPointer = fileVelCoordsX.data();
+         if (file.read("MESH_NODE_CRDS_X",attribs,0,fileMeshBBox[0]*fileMeshBBox[3]+1,tempPointer,false) == false) {
+            logFile << "(RESTART) ERROR: Failed to read MESH_NODE_CRDS_X at " << __FILE__ << ":" << __LINE__ << endl << write;
+            success = false;
+         }
+         tempPointer = fileVelCoordsY.data();
+         if (file.read("MESH_NODE_CRDS_Y",attribs,0,fileMeshBBox[1]*fileMeshBBox[4]+1,tempPointer,false) == false) {
+            logFile << "(RESTART) ERROR: Failed to read MESH_NODE_CRDS_X at " << __FILE__ << ":" << __LINE__ << endl << write;
+            success = false;
+         }
+         tempPointer = fileVelCoordsZ.data();
+         if (file.read("MESH_NODE_CRDS_Z",attribs,0,fileMeshBBox[2]*fileMeshBBox[5]+1,tempPointer,false) == false) {
+            logFile << "(RESTART) ERROR: Failed to read MESH_NODE_CRDS_X at " << __FILE__ << ":" << __LINE__ << endl << write;
+            success = false;
+         }
+
+         const Real dVx = getObjectWrapper().velocityMeshes[meshID].cellSize[0];
+         for(const auto& c : fileVelCoordsX) {
+            Real cellindex = (c - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[0]) / dVx;
+            if(fabs(nearbyint(cellindex) - cellindex) > 1./10000.) {
+               logFile << "(RESTART) ERROR: Can't resize velocity space as cell coordinates don't match." << endl
+                  << "          (X coordinate " << c << " = " << cellindex <<" * " << dVx << " + " << getObjectWrapper().velocityMeshes[meshID].meshMinLimits[0] << endl
+                  << "           coordinate  = cellindex *   dV  +  meshMinLimits)" << endl << write;
+               abort();
+            }
+         }
+
+         const Real dVy = getObjectWrapper().velocityMeshes[meshID].cellSize[1];
+         for(const auto& c : fileVelCoordsY) {
+            Real cellindex = (c - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[1]) / dVy;
+            if(fabs(nearbyint(cellindex) - cellindex) > 1./10000.) {
+               logFile << "(RESTART) ERROR: Can't resize velocity space as cell coordinates don't match." << endl
+                  << "           (Y coordinate " << c << " = " << cellindex <<" * " << dVy << " + " << getObjectWrapper().velocityMeshes[meshID].meshMinLimits[1] << endl
+                  << "           coordinate  = cellindex *   dV  +  meshMinLimits)" << endl << write;
+               abort();
+            }
+         }
+
+         const Real dVz = getObjectWrapper().velocityMeshes[meshID].cellSize[2];
+         for(const auto& c : fileVelCoordsY) {
+            Real cellindex = (c - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[2]) / dVz;
+            if(fabs(nearbyint(cellindex) - cellindex) > 1./10000.) {
+               logFile << "(RESTART) ERROR: Can't resize velocity space as cell coordinates don't match." << endl
+                  << "           (Z coordinate " << c << " = " << cellindex <<" * " << dVz << " + " << getObjectWrapper().velocityMeshes[meshID].meshMinLimits[2] << endl
+                  << "           coordinate  = cellindex *   dV  +  meshMinLimits)" << endl << write;
+               abort();
+            }
+         }
+
+         // If we haven't aborted above, we can apparently renumber our
+         // cellIDs. Build an approprita blockIDremapper lambda for this purpose.
+         std::array<int, 3> velGridOffset;
+         velGridOffset[0] = (fileVelCoordsX[0] - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[0]) / dVx;
+         velGridOffset[1] = (fileVelCoordsY[0] - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[1]) / dVy;
+         velGridOffset[2] = (fileVelCoordsZ[0] - getObjectWrapper().velocityMeshes[meshID].meshMinLimits[2]) / dVz;
+
+         if((velGridOffset[0] % ourMeshParams.blockLength[0] != 0) ||
+               (velGridOffset[1] % ourMeshParams.blockLength[1] != 0) ||
+               (velGridOffset[2] % ourMeshParams.blockLength[2] != 0)) {
+            logFile << "(RESTART) ERROR: resizing velocity space on restart must end up with the old velocity space" << endl
+                    << "                 at a block boundary of the new space!" << endl
+                    << "                 (It now starts at cell [" << velGridOffset[0] << ", " << velGridOffset[1] << "," << velGridOffset[2] << "])" << endl << write;
+            abort();
+         }
+
+         velGridOffset[0] /= ourMeshParams.blockLength[0];
+         velGridOffset[1] /= ourMeshParams.blockLength[1];
+         velGridOffset[2] /= ourMeshParams.blockLength[2];
+
+         blockIDremapper = [fileMeshBBox,velGridOffset,ourMeshParams](vmesh::GlobalID oldID) -> vmesh::GlobalID {
+            unsigned int x,y,z;
+            x = oldID % fileMeshBBox[0];
+            y = (oldID / fileMeshBBox[0]) % fileMeshBBox[1];
+            z = oldID / (fileMeshBBox[0] * fileMeshBBox[1]);
+
+            x += velGridOffset[0];
+            y += velGridOffset[1];
+            z += velGridOffset[2];
+
+            //logFile << " Remapping " << oldID << "(" << x << "," << y << "," << z << ") to " << x + y * ourMeshParams.gridLength[0] + z* ourMeshParams.gridLength[0] * ourMeshParams.gridLength[1] << endl << write;
+            return x + y * ourMeshParams.gridLength[0] + z* ourMeshParams.gridLength[0] * ourMeshParams.gridLength[1];
+         };
+
+         logFile << "    => Resizing velocity space by renumbering GlobalIDs." << endl << endl << write;
+      }
+
+      // In restart files each spatial cell has an entry in CELLSWITHBLOCKS. 
+      // Each process calculates how many velocity blocks it has for this species.
+      attribs.clear();
+      attribs.push_back(make_pair("mesh",meshName));
+      attribs.push_back(make_pair("name",popName));
+      vmesh::LocalID* blocksPerCell = NULL;
+      
+      if (file.read("BLOCKSPERCELL",attribs,localCellStartOffset,localCells,blocksPerCell,true) == false) {
+         logFile << "(RESTART) ERROR: Failed to read BLOCKSPERCELL at " << __FILE__ << ":" << __LINE__ << endl << write;
+         success = false;
+      }
+
+      // Count how many velocity blocks this process gets
+      uint64_t blockSum = 0;
+      for (uint64_t i=0; i<localCells; ++i){
+         blockSum += blocksPerCell[i];
+      }
+      
+      // Gather all block sums to master process who will them broadcast 
+      // the values to everyone
+      MPI_Allgather(&blockSum,1,MPI_Type<uint64_t>(),offsetArray,1,MPI_Type<uint64_t>(),MPI_COMM_WORLD);      
+      
+      // Calculate the offset from which this process starts reading block data
+      uint64_t myOffset = 0;
+      for (int i=0; i<myRank; ++i) myOffset += offsetArray[i];
+      
+      if (file.getArrayInfo("BLOCKVARIABLE",attribs,arraySize,vectorSize,dataType,byteSize) == false) {
+         logFile << "(RESTART)  ERROR: Failed to read BLOCKVARIABLE INFO" << endl << write;
+         return false;
+      }
+
+      // Call _readBlockData
+      if (dataType == vlsv::datatype::type::FLOAT) {
+         switch (byteSize) {
+            case sizeof(double):
+               if (_readBlockData<double>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                          myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+            case sizeof(float):
+               if (_readBlockData<float>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                         myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+         }
+      } else if (dataType == vlsv::datatype::type::UINT) {
+         switch (byteSize) {
+            case sizeof(uint32_t):
+               if (_readBlockData<uint32_t>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                            myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+            case sizeof(uint64_t):
+               if (_readBlockData<uint64_t>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                            myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+         }
+      } else if (dataType == vlsv::datatype::type::INT) {
+         switch (byteSize) {
+            case sizeof(int32_t):
+               if (_readBlockData<int32_t>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                           myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+            case sizeof(int64_t):
+               if (_readBlockData<int64_t>(file,meshName,fileCells,localCellStartOffset,localCells,blocksPerCell,
+                                           myOffset,blockSum,getCell,blockIDremapper,popID) == false) success = false;
+               break;
+         }
+      } else {
+         logFile << "(RESTART) ERROR: Failed to read data type at readCellParamsVariable" << endl << write;
+         success = false;
+      }
+      delete [] blocksPerCell; blocksPerCell = NULL;
+   } // for-loop over particle species
+
+   delete [] offsetArray; offsetArray = NULL;
+   
+   const uint64_t bytesReadEnd = file.getBytesRead() - bytesReadStart;
+   logFile << "Velocity meshes and data read, approximate data rate is ";
+   logFile << vlsv::printDataRate(bytesReadEnd,file.getReadTime()) << endl << write;
+
+   return success;
+}
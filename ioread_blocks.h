@@ -0,0 +1,63 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef IOREAD_BLOCKS_H
+#define IOREAD_BLOCKS_H
+#include "mpi.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vlsv_reader_parallel.h"
+#include "definitions.h"
+#include "spatial_cell.hpp"
+
+/* Reading of the spatial cell IDs and velocity block data of a restart file.
+ * Kept apart from ioread.cpp and independent of the spatial grid library so
+ * that tools and mini-apps can load production distributions.*/
+
+/*!
+\brief Read the IDs of all spatial cells in the file, in file order
+\param file VLSV reader with the file open
+\param fileCells Vector in which to store the cell IDs
+\param masterRank Rank that reads the IDs and broadcasts them
+\param comm MPI comm
+*/
+bool readCellIds(vlsv::ParallelReader& file,std::vector<CellID>& fileCells,const int masterRank,MPI_Comm comm);
+
+/*!
+\brief Read the velocity block data of all particle species
+\param file VLSV reader with the file open
+\param meshName Name of the spatial mesh
+\param fileCells IDs of all spatial cells in the file, in file order
+\param localCellStartOffset Offset into fileCells from which the cells of this process start,
+the cells of lower ranks must come before the cells of this process
+\param localCells Number of spatial cells read by this process
+\param getCell Function returning the spatial cell with the given ID
+*/
+bool readBlockData(vlsv::ParallelReader& file,
+                   const std::string& meshName,
+                   const std::vector<CellID>& fileCells,
+                   const uint64_t localCellStartOffset,
+                   const uint64_t localCells,
+                   const std::function<spatial_cell::SpatialCell*(const CellID&)>& getCell);
+
+#endif
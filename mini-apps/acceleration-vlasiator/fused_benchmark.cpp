@@ -0,0 +1,210 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Benchmark of the acceleration mappings of Vlasiator. A Maxwellian
+ * distribution is rotated and shifted in velocity space, once with three
+ * calls to map_1d per subcycle and once with map_3d_fused, and the run
+ * times and the final distributions of the two are compared.
+ *
+ * Usage: fused_benchmark [subcycles] [blocks per dimension] [thermal speed / block size]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mpi.h>
+#include <Eigen/Geometry>
+#include <Eigen/Core>
+
+#include "../../spatial_cell.hpp"
+#include "../../object_wrapper.h"
+#include "../../sysboundary/sysboundary.h"
+#include "../../fieldtracing/fieldtracing.h"
+#include "../../vlasovsolver/cpu_acc_map.hpp"
+#include "../../vlasovsolver/cpu_acc_intersections.hpp"
+
+using namespace std;
+using namespace spatial_cell;
+using namespace Eigen;
+
+Logger logFile,diagnostic;
+int globalflags::bailingOut=0;
+bool globalflags::writeRestart=0;
+bool globalflags::balanceLoad=0;
+bool globalflags::doRefine=0;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+
+// Boundaries and field tracing are not part of this benchmark
+SysBoundary::SysBoundary() {}
+SysBoundary::~SysBoundary() {}
+namespace FieldTracing {
+   FieldTracingParameters fieldTracingParameters;
+}
+
+/** Fill the cell with a drifting Maxwellian, blocks whose maximum value
+ * is below the sparsity threshold are not created.*/
+void initializeCell(SpatialCell& cell, const Real vth, const Real drift[3]) {
+   const uint popID = 0;
+   const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell.get_velocity_mesh(popID);
+   const uint8_t refLevel = 0;
+   const vmesh::LocalID* gridLength = vmesh.getGridLength(refLevel);
+   const Real* dv = vmesh.getCellSize(refLevel);
+   Realf values[WID3];
+
+   for (vmesh::LocalID k=0; k<gridLength[2]; ++k) for (vmesh::LocalID j=0; j<gridLength[1]; ++j) for (vmesh::LocalID i=0; i<gridLength[0]; ++i) {
+      const vmesh::GlobalID blockGID = vmesh.getGlobalID(refLevel,i,j,k);
+      Real blockCoords[3];
+      vmesh.getBlockCoordinates(blockGID,blockCoords);
+      Realf maxValue = 0;
+      for (uint kc=0; kc<WID; ++kc) for (uint jc=0; jc<WID; ++jc) for (uint ic=0; ic<WID; ++ic) {
+         const Real vx = blockCoords[0] + (ic+0.5)*dv[0] - drift[0];
+         const Real vy = blockCoords[1] + (jc+0.5)*dv[1] - drift[1];
+         const Real vz = blockCoords[2] + (kc+0.5)*dv[2] - drift[2];
+         values[vblock::index(ic,jc,kc)] = 1.0e6 * exp(-(vx*vx + vy*vy + vz*vz) / (vth*vth));
+         maxValue = max(maxValue, values[vblock::index(ic,jc,kc)]);
+      }
+      if (maxValue < cell.getVelocityBlockMinValue(popID)) continue;
+      cell.add_velocity_block(blockGID,popID);
+      Realf* data = cell.get_data(cell.get_velocity_block_local_id(blockGID,popID),popID);
+      for (uint c=0; c<WID3; ++c) data[c] = values[c];
+   }
+}
+
+Real totalMass(SpatialCell& cell) {
+   Real mass = 0;
+   const Realf* data = cell.get_data(0);
+   for (vmesh::LocalID b=0; b<cell.get_number_of_velocity_blocks(0); ++b) {
+      for (uint c=0; c<WID3; ++c) mass += data[b*WID3+c];
+   }
+   return mass;
+}
+
+int main(int argn,char* args[]) {
+   MPI_Init(&argn,&args);
+   const int subcycles = (argn > 1) ? atoi(args[1]) : 20;
+   const uint blocksPerDim = (argn > 2) ? atoi(args[2]) : 40;
+   const Real thermalBlocks = (argn > 3) ? atof(args[3]) : 4.0;
+
+   // Velocity mesh and a single proton population
+   vmesh::MeshParameters meshParameters;
+   meshParameters.name = "benchmark";
+   for (int d=0; d<3; ++d) {
+      meshParameters.meshLimits[2*d] = -4.0e6;
+      meshParameters.meshLimits[2*d+1] = 4.0e6;
+      meshParameters.gridLength[d] = blocksPerDim;
+      meshParameters.blockLength[d] = WID;
+   }
+   meshParameters.refLevelMaxAllowed = 0;
+   objectWrapper.velocityMeshes.push_back(meshParameters);
+
+   species::Species proton;
+   proton.name = "proton";
+   proton.charge = physicalconstants::CHARGE;
+   proton.mass = physicalconstants::MASS_PROTON;
+   proton.sparseMinValue = 1.0e-15;
+   proton.velocityMesh = 0;
+   objectWrapper.particleSpecies.push_back(proton);
+
+   // The default box size limit is meant for the cache, allow the whole mesh here
+   Parameters::vlasovAccelerationFusedMaxBoxBlocks = blocksPerDim * blocksPerDim * blocksPerDim;
+
+   const Real blockSize = 8.0e6 / blocksPerDim;
+   const Real drift[3] = {0.2e6, -0.1e6, 0.05e6};
+   SpatialCell reference;
+   reference.initialize_mesh();
+   initializeCell(reference, thermalBlocks * blockSize, drift);
+   SpatialCell fused = reference;
+   const Real initialMass = totalMass(reference);
+
+   // Gyration around a tilted axis with a small drift, as in a typical
+   // acceleration subcycle
+   const Real angle = 0.05;
+   Transform<Real,3,Affine> fwd_transform = Transform<Real,3,Affine>::Identity();
+   fwd_transform.rotate(AngleAxis<Real>(angle, Matrix<Real,3,1>(0.3, 0.5, 0.8).normalized()));
+   fwd_transform.pretranslate(Matrix<Real,3,1>(0.1*blockSize, -0.05*blockSize, 0.02*blockSize));
+   const Transform<Real,3,Affine> bwd_transform = fwd_transform.inverse();
+
+   // Map order XYZ
+   const uint dims[3] = {0, 1, 2};
+   const uint8_t refLevel = 0;
+   Real is[3][4];
+   const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = reference.get_velocity_mesh(0);
+   compute_intersections_1st(vmesh, bwd_transform, fwd_transform, dims[0], refLevel, is[0][0], is[0][1], is[0][2], is[0][3]);
+   compute_intersections_2nd(vmesh, bwd_transform, fwd_transform, dims[1], refLevel, is[1][0], is[1][1], is[1][2], is[1][3]);
+   compute_intersections_3rd(vmesh, bwd_transform, fwd_transform, dims[2], refLevel, is[2][0], is[2][1], is[2][2], is[2][3]);
+   Realv intersections[3][4];
+   for (int m=0; m<3; ++m) for (int i=0; i<4; ++i) intersections[m][i] = is[m][i];
+
+   cout << "Initial blocks " << reference.get_number_of_velocity_blocks(0) << ", mass " << initialMass << endl;
+
+   auto start = chrono::steady_clock::now();
+   for (int s=0; s<subcycles; ++s) {
+      for (int m=0; m<3; ++m) {
+         map_1d(&reference, 0, intersections[m][0], intersections[m][1], intersections[m][2], intersections[m][3], dims[m]);
+      }
+   }
+   const double referenceTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   start = chrono::steady_clock::now();
+   for (int s=0; s<subcycles; ++s) {
+      if (map_3d_fused(&fused, 0, dims, intersections) == false) {
+         cerr << "Velocity box does not fit, increase vlasovsolver.accelerationFusedMaxBoxRatio" << endl;
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+   const double fusedTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   // Compare the distributions, blocks missing from one of them are zero
+   Real maxValue = 0;
+   Real maxDifference = 0;
+   const vmesh::LocalID nReference = reference.get_number_of_velocity_blocks(0);
+   for (vmesh::LocalID b=0; b<nReference; ++b) {
+      const vmesh::GlobalID blockGID = reference.get_velocity_block_global_id(b,0);
+      const vmesh::LocalID fusedLID = fused.get_velocity_block_local_id(blockGID,0);
+      const Realf* data = reference.get_data(b,0);
+      for (uint c=0; c<WID3; ++c) {
+         const Realf fusedValue = (fusedLID == vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) ? 0 : fused.get_data(fusedLID,0)[c];
+         maxValue = max(maxValue, (Real)fabs(data[c]));
+         maxDifference = max(maxDifference, (Real)fabs(data[c] - fusedValue));
+      }
+   }
+   for (vmesh::LocalID b=0; b<fused.get_number_of_velocity_blocks(0); ++b) {
+      const vmesh::GlobalID blockGID = fused.get_velocity_block_global_id(b,0);
+      if (reference.get_velocity_block_local_id(blockGID,0) != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) continue;
+      const Realf* data = fused.get_data(b,0);
+      for (uint c=0; c<WID3; ++c) maxDifference = max(maxDifference, (Real)fabs(data[c]));
+   }
+
+   cout << "map_1d:       " << referenceTime / subcycles << " s/subcycle, "
+        << nReference << " blocks, relative mass change " << totalMass(reference) / initialMass - 1 << endl;
+   cout << "map_3d_fused: " << fusedTime / subcycles << " s/subcycle, "
+        << fused.get_number_of_velocity_blocks(0) << " blocks, relative mass change " << totalMass(fused) / initialMass - 1 << endl;
+   cout << "Speedup " << referenceTime / fusedTime << ", max difference relative to max value " << maxDifference / maxValue << endl;
+
+   MPI_Finalize();
+   return 0;
+}
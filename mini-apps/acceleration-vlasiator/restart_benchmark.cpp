@@ -0,0 +1,284 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Benchmark of the acceleration of Vlasiator on production distributions.
+ * The velocity distributions of the first spatial cells of a restart file
+ * are read with the same readBlockData as a restart of Vlasiator, and they
+ * are accelerated with cpu_accelerate_cell of the Vlasov solver, once for
+ * each kernel variant:
+ *   cell   map_1d
+ *   fused  map_3d_fused
+ * Each subcycle rotates the distributions by the maximum allowed angle
+ * (vlasovsolver.maxSlAccelerationRotation) in the given magnetic field,
+ * since restart files do not contain the volume averaged field of the
+ * Vlasov grid. Blocks are adjusted between subcycles as in Vlasiator, this
+ * is not timed. Reported are the accelerated blocks per second, the
+ * effective bandwidth counting one read and one write of the distribution
+ * per dimension, and the relative change of the number density.
+ *
+ * Usage: mpirun -n N restart_benchmark --run_config run.cfg --restart.filename restart.0000100.vlsv
+ *        [--benchmark.cells 100] [--benchmark.subcycles 5]
+ *        [--benchmark.Bx 0] [--benchmark.By 0] [--benchmark.Bz 5e-9]
+ * The configuration file has to define the particle populations and their
+ * velocity meshes as in the run that wrote the restart file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <mpi.h>
+
+#include "../../spatial_cell.hpp"
+#include "../../mpiconversion.h"
+#include "../../object_wrapper.h"
+#include "../../readparameters.h"
+#include "../../ioread_blocks.h"
+#include "../../sysboundary/sysboundary.h"
+#include "../../sysboundary/ionosphere.h"
+#include "../../fieldtracing/fieldtracing.h"
+#include "../../vlasovsolver/cpu_acc_semilag.hpp"
+#include "../../vlasovsolver/cpu_moments.h"
+
+using namespace std;
+using namespace spatial_cell;
+
+typedef Readparameters RP;
+
+Logger logFile,diagnostic;
+int globalflags::bailingOut=0;
+bool globalflags::writeRestart=0;
+bool globalflags::balanceLoad=0;
+bool globalflags::doRefine=0;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+
+// The acceleration transform refers to the ionosphere boundary, which is
+// not part of this benchmark
+SysBoundary::SysBoundary() {}
+SysBoundary::~SysBoundary() {}
+SBC::SysBoundaryCondition* SysBoundary::getSysBoundary(cuint sysBoundaryType) const { return NULL; }
+namespace SBC {
+   IonosphereBoundaryVDFmode boundaryVDFmode = FixedMoments;
+}
+namespace FieldTracing {
+   FieldTracingParameters fieldTracingParameters;
+}
+
+struct KernelVariant {
+   string name;
+   bool fused;
+};
+
+/** Compute the "_V" moments of the cell needed by the acceleration
+ * transform, as calculateMoments_V does.*/
+void computeMoments(SpatialCell& cell) {
+   cell.parameters[CellParams::RHOM_V] = 0.0;
+   cell.parameters[CellParams::VX_V] = 0.0;
+   cell.parameters[CellParams::VY_V] = 0.0;
+   cell.parameters[CellParams::VZ_V] = 0.0;
+   cell.parameters[CellParams::RHOQ_V] = 0.0;
+   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+      const vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell.get_velocity_blocks(popID);
+      Real array[4] = {0.0, 0.0, 0.0, 0.0};
+      for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+         blockVelocityFirstMoments(blockContainer.getData()+blockLID*WID3,
+                                   blockContainer.getParameters()+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                   array);
+      }
+      Population& pop = cell.get_population(popID);
+      pop.RHO_V = array[0];
+      for (int i=0; i<3; ++i) pop.V_V[i] = (array[0] > 0.0) ? array[i+1] / array[0] : 0.0;
+
+      const Real mass = getObjectWrapper().particleSpecies[popID].mass;
+      cell.parameters[CellParams::RHOM_V] += array[0]*mass;
+      cell.parameters[CellParams::VX_V] += array[1]*mass;
+      cell.parameters[CellParams::VY_V] += array[2]*mass;
+      cell.parameters[CellParams::VZ_V] += array[3]*mass;
+      cell.parameters[CellParams::RHOQ_V] += array[0]*getObjectWrapper().particleSpecies[popID].charge;
+   }
+   if (cell.parameters[CellParams::RHOM_V] > 0.0) {
+      cell.parameters[CellParams::VX_V] /= cell.parameters[CellParams::RHOM_V];
+      cell.parameters[CellParams::VY_V] /= cell.parameters[CellParams::RHOM_V];
+      cell.parameters[CellParams::VZ_V] /= cell.parameters[CellParams::RHOM_V];
+   }
+}
+
+/** Number density of the population summed over all local cells.*/
+Real totalDensity(vector<SpatialCell>& cells, const uint popID) {
+   Real density = 0.0;
+   for (size_t c=0; c<cells.size(); ++c) {
+      const vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cells[c].get_velocity_blocks(popID);
+      Real array[4] = {0.0, 0.0, 0.0, 0.0};
+      for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+         blockVelocityFirstMoments(blockContainer.getData()+blockLID*WID3,
+                                   blockContainer.getParameters()+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                   array);
+      }
+      density += array[0];
+   }
+   return density;
+}
+
+/** Accelerate the population of all cells over one subcycle.*/
+void accelerate(vector<SpatialCell>& cells, const uint popID, const uint map_order, const vector<Real>& dt) {
+   #pragma omp parallel for schedule(dynamic,1)
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (cells[c].get_number_of_velocity_blocks(popID) == 0) continue;
+      cpu_accelerate_cell(&cells[c],popID,map_order,dt[c]);
+   }
+}
+
+int main(int argn,char* args[]) {
+   int required = MPI_THREAD_FUNNELED;
+   int provided;
+   MPI_Init_thread(&argn,&args,required,&provided);
+   int myRank,processes;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   MPI_Comm_size(MPI_COMM_WORLD,&processes);
+
+   // Populations and velocity meshes are read from the configuration file
+   // of the run, as in Vlasiator
+   Readparameters readparameters(argn,args);
+   P::addParameters();
+   getObjectWrapper().addParameters();
+   RP::add("benchmark.cells", "Number of spatial cells read from the beginning of the restart file.", 100);
+   RP::add("benchmark.subcycles", "Number of accelerated subcycles per kernel variant.", 5);
+   RP::add("benchmark.Bx", "Magnetic field x component (T) of all cells.", 0.0);
+   RP::add("benchmark.By", "Magnetic field y component (T) of all cells.", 0.0);
+   RP::add("benchmark.Bz", "Magnetic field z component (T) of all cells.", 5.0e-9);
+   readparameters.parse();
+   P::getParameters();
+   getObjectWrapper().addPopulationParameters();
+   // Project and boundary options of the configuration file are not known here
+   readparameters.parse(true, true);
+   readparameters.helpMessage();
+   getObjectWrapper().getParameters();
+
+   uint nCells, subcycles;
+   Real B[3];
+   RP::get("benchmark.cells", nCells);
+   RP::get("benchmark.subcycles", subcycles);
+   RP::get("benchmark.Bx", B[0]);
+   RP::get("benchmark.By", B[1]);
+   RP::get("benchmark.Bz", B[2]);
+
+   if (P::restartFileName.size() == 0) {
+      if (myRank == MASTER_RANK) cerr << "Give the restart file with --restart.filename" << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   if (logFile.open(MPI_COMM_WORLD,MASTER_RANK,"logfile.txt") == false) {
+      if (myRank == MASTER_RANK) cerr << "Failed to open logfile.txt" << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   // Read the first cells of the file, split evenly between the processes
+   // in file order as readBlockData expects
+   vlsv::ParallelReader file;
+   if (file.open(P::restartFileName,MPI_COMM_WORLD,MASTER_RANK,MPI_INFO_NULL) == false) {
+      if (myRank == MASTER_RANK) cerr << "Failed to open " << P::restartFileName << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   vector<CellID> fileCells;
+   if (readCellIds(file,fileCells,MASTER_RANK,MPI_COMM_WORLD) == false) {
+      cerr << "Failed to read the cell IDs of " << P::restartFileName << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   const uint64_t readCells = min((uint64_t)nCells, (uint64_t)fileCells.size());
+   const uint64_t localCellStartOffset = readCells * myRank / processes;
+   const uint64_t localCells = readCells * (myRank+1) / processes - localCellStartOffset;
+
+   vector<SpatialCell> original(localCells);
+   unordered_map<CellID,size_t> cellIndex;
+   for (uint64_t i=0; i<localCells; ++i) {
+      original[i].initialize_mesh();
+      cellIndex[fileCells[localCellStartOffset+i]] = i;
+   }
+   if (readBlockData(file,"SpatialGrid",fileCells,localCellStartOffset,localCells,
+                     [&](const CellID& cell) -> SpatialCell* {return &original[cellIndex.at(cell)];}) == false) {
+      cerr << "Failed to read the velocity blocks of " << P::restartFileName << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   file.close();
+
+   for (size_t c=0; c<original.size(); ++c) {
+      original[c].parameters[CellParams::BGBXVOL] = B[0];
+      original[c].parameters[CellParams::BGBYVOL] = B[1];
+      original[c].parameters[CellParams::BGBZVOL] = B[2];
+      computeMoments(original[c]);
+   }
+
+   const vector<KernelVariant> variants {{"cell", false}, {"fused", true}};
+   if (myRank == MASTER_RANK) {
+      cout << "Read " << readCells << " cells of " << P::restartFileName << " on " << processes << " processes" << endl;
+   }
+
+   for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+      // One subcycle at the maximum allowed rotation of each cell
+      vector<Real> dt(original.size());
+      for (size_t c=0; c<original.size(); ++c) {
+         prepareAccelerateCell(&original[c], popID);
+         dt[c] = original[c].get_max_v_dt(popID);
+      }
+      Real initialDensity = totalDensity(original, popID);
+      MPI_Allreduce(MPI_IN_PLACE, &initialDensity, 1, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+
+      for (const auto& variant: variants) {
+         P::vlasovAccelerationFused = variant.fused;
+         vector<SpatialCell> cells = original;
+
+         double time = 0.0;
+         uint64_t blockSubcycles = 0;
+         for (uint s=0; s<subcycles; ++s) {
+            for (size_t c=0; c<cells.size(); ++c) blockSubcycles += cells[c].get_number_of_velocity_blocks(popID);
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            const double t1 = MPI_Wtime();
+            accelerate(cells, popID, s % 3, dt);
+            time += MPI_Wtime() - t1;
+
+            #pragma omp parallel for schedule(dynamic,1)
+            for (size_t c=0; c<cells.size(); ++c) cells[c].adjustSingleCellVelocityBlocks(popID, true);
+         }
+
+         Real density = totalDensity(cells, popID);
+         MPI_Allreduce(MPI_IN_PLACE, &density, 1, MPI_Type<Real>(), MPI_SUM, MPI_COMM_WORLD);
+         MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+         MPI_Allreduce(MPI_IN_PLACE, &blockSubcycles, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+         if (myRank == MASTER_RANK) {
+            const double bytes = 2.0 * 3.0 * WID3 * sizeof(Realf) * blockSubcycles;
+            cout << getObjectWrapper().particleSpecies[popID].name << " " << variant.name << ": "
+                 << blockSubcycles / time << " blocks/s, "
+                 << bytes / time * 1e-9 << " GB/s, "
+                 << "relative density change " << density / initialDensity - 1 << endl;
+         }
+      }
+   }
+
+   logFile.close();
+   MPI_Finalize();
+   return 0;
+}
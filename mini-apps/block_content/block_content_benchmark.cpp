@@ -0,0 +1,131 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Benchmark of the block content scans of cpu_block_content.hpp. The blocks
+ * of a Maxwellian distribution, with the sparse halo of blocks below the
+ * threshold around it, are classified against the sparsity threshold with
+ * the scalar loop of the original compute_block_has_content, with
+ * blockHasContent and with blockMaxValue. The classifications and the
+ * maximum values of the vectorised scans have to be identical to the scalar
+ * ones, the program returns nonzero otherwise.
+ *
+ * Usage: block_content_benchmark [blocks per dimension] [repetitions]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "common.h"
+#include "vlasovsolver/cpu_block_content.hpp"
+
+using namespace std;
+
+const Real threshold = 1.0e-15;
+
+/** Maxwellian in a cube of blocks, a bit less than half of the blocks are
+ * above the threshold.*/
+void fillBlocks(vector<Realf>& data, const uint blocksPerDim) {
+   const uint cellsPerDim = blocksPerDim * WID;
+   const Real vth = 0.14 * cellsPerDim;
+   data.resize((size_t)blocksPerDim * blocksPerDim * blocksPerDim * WID3);
+   size_t n = 0;
+   for (uint kb = 0; kb < blocksPerDim; ++kb) for (uint jb = 0; jb < blocksPerDim; ++jb) for (uint ib = 0; ib < blocksPerDim; ++ib) {
+      for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
+         const Real vx = ib * WID + i + 0.5 - 0.5 * cellsPerDim;
+         const Real vy = jb * WID + j + 0.5 - 0.5 * cellsPerDim;
+         const Real vz = kb * WID + k + 0.5 - 0.5 * cellsPerDim;
+         data[n++] = 1.0e-9 * exp(-(vx * vx + vy * vy + vz * vz) / (vth * vth));
+      }
+   }
+}
+
+int main(int argn, char* args[]) {
+   const uint blocksPerDim = (argn > 1) ? atoi(args[1]) : 32;
+   const int repetitions = (argn > 2) ? atoi(args[2]) : 20;
+
+   vector<Realf> data;
+   fillBlocks(data, blocksPerDim);
+   const size_t nBlocks = data.size() / WID3;
+   vector<uint8_t> scalarContent(nBlocks), earlyExitContent(nBlocks), maxContent(nBlocks);
+   vector<Realv> scalarMax(nBlocks), vectorMax(nBlocks);
+   const Realv thresholdV = vectorThreshold(threshold);
+
+   double scalarTime = 1e300, earlyExitTime = 1e300, maxTime = 1e300, scalarMaxTime = 1e300;
+   for (int r = 0; r < repetitions; ++r) {
+      auto start = chrono::steady_clock::now();
+      for (size_t b = 0; b < nBlocks; ++b) {
+         const Realf* block = data.data() + b * WID3;
+         bool hasContent = false;
+         for (uint i = 0; i < WID3; ++i) {
+            if (block[i] >= threshold) {
+               hasContent = true;
+               break;
+            }
+         }
+         scalarContent[b] = hasContent;
+      }
+      scalarTime = min(scalarTime, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+      start = chrono::steady_clock::now();
+      for (size_t b = 0; b < nBlocks; ++b) {
+         Realv maxValue = data[b * WID3];
+         for (uint i = 1; i < WID3; ++i) maxValue = max(maxValue, (Realv)data[b * WID3 + i]);
+         scalarMax[b] = maxValue;
+      }
+      scalarMaxTime = min(scalarMaxTime, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+      start = chrono::steady_clock::now();
+      for (size_t b = 0; b < nBlocks; ++b) {
+         earlyExitContent[b] = blockHasContent(data.data() + b * WID3, thresholdV);
+      }
+      earlyExitTime = min(earlyExitTime, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+      start = chrono::steady_clock::now();
+      for (size_t b = 0; b < nBlocks; ++b) {
+         vectorMax[b] = blockMaxValue(data.data() + b * WID3);
+         maxContent[b] = vectorMax[b] >= thresholdV;
+      }
+      maxTime = min(maxTime, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+   }
+
+   size_t nContent = 0, nMismatch = 0;
+   for (size_t b = 0; b < nBlocks; ++b) {
+      nContent += scalarContent[b];
+      if (earlyExitContent[b] != scalarContent[b] || maxContent[b] != scalarContent[b] || vectorMax[b] != scalarMax[b]) ++nMismatch;
+   }
+
+   const double ns = 1.0e9 / nBlocks;
+   cout << nBlocks << " blocks, " << nContent << " with content, VECL " << VECL << endl;
+   cout << "scalar classification:  " << scalarTime * ns << " ns/block" << endl;
+   cout << "scalar maximum:         " << scalarMaxTime * ns << " ns/block" << endl;
+   cout << "blockHasContent:        " << earlyExitTime * ns << " ns/block, speedup " << scalarTime / earlyExitTime << endl;
+   cout << "blockMaxValue:          " << maxTime * ns << " ns/block, speedup " << scalarTime / maxTime
+        << " (classification), " << scalarMaxTime / maxTime << " (maximum)" << endl;
+   if (nMismatch > 0) {
+      cerr << "ERROR: " << nMismatch << " blocks differ from the scalar scans" << endl;
+      return 1;
+   }
+   return 0;
+}
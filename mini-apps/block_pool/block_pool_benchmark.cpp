@@ -0,0 +1,117 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Benchmark of the storage of velocity blocks with and without
+ * vmesh::BlockPool. A set of VelocityBlockContainers grows and shrinks
+ * block by block as the cells of a run do, and shrink_to_fit style
+ * recapacitate calls follow each phase. The live block bytes, the capacity
+ * reported by capacityInBytes, the resident memory of the process and the
+ * run time are printed for both storages, and the blocks are checked
+ * against their expected values. Each storage runs in its own process so
+ * that the resident memory of one does not affect the other. The program
+ * returns nonzero if the check fails.
+ *
+ * Usage: block_pool_benchmark [0 (vectors) or 1 (pool)] [cells] [phases]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include "memoryallocation.h"
+#include "common.h"
+#include "velocity_block_container.h"
+
+using namespace std;
+
+typedef vmesh::VelocityBlockContainer<vmesh::LocalID> Container;
+
+/** Resident memory of the process in bytes.*/
+double residentBytes() {
+   ifstream status("/proc/self/status");
+   string line;
+   while (getline(status, line)) {
+      if (line.compare(0, 6, "VmRSS:") == 0) return 1024.0 * atof(line.c_str() + 6);
+   }
+   return 0;
+}
+
+/** Number of blocks of a cell in a phase, cells grow and shrink at different rates.*/
+vmesh::LocalID targetBlocks(const size_t cell, const int phase) {
+   const vmesh::LocalID maxBlocks = 2000 + 500 * (cell % 13);
+   const int period = 6 + cell % 5;
+   const int step = phase % period;
+   return maxBlocks * (step < period / 2 ? step + 1 : period - step) / (period / 2 + 1);
+}
+
+int main(int argn, char* args[]) {
+   MPI_Init(&argn, &args);
+   const bool pooled = (argn > 1) ? atoi(args[1]) : 1;
+   const size_t nCells = (argn > 2) ? atoi(args[2]) : 1000;
+   const int nPhases = (argn > 3) ? atoi(args[3]) : 20;
+
+   vmesh::BlockPool::instance().setEnabled(pooled);
+   const double initialResident = residentBytes();
+   vector<Container> cells(nCells);
+   double maxResident = 0, maxLive = 0;
+   bool valid = true;
+
+   auto start = chrono::steady_clock::now();
+   for (int phase = 0; phase < nPhases; ++phase) {
+      double live = 0;
+      for (size_t c = 0; c < nCells; ++c) {
+         Container& cell = cells[c];
+         const vmesh::LocalID target = targetBlocks(c, phase);
+         while (cell.size() < target) {
+            const vmesh::LocalID blockLID = cell.push_back();
+            cell.getData(blockLID)[0] = blockLID;
+            cell.getParameters(blockLID)[0] = blockLID;
+         }
+         while (cell.size() > target) cell.pop();
+         cell.recapacitate(2 + cell.size() * Container::getBlockAllocationFactor());
+         live += cell.size() * (WID3 * sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS * sizeof(Real));
+      }
+      maxLive = max(maxLive, live);
+      maxResident = max(maxResident, residentBytes() - initialResident);
+   }
+   const double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   double capacity = 0;
+   for (const Container& cell : cells) {
+      capacity += cell.capacityInBytes();
+      for (vmesh::LocalID b = 0; b < cell.size(); ++b) {
+         if (cell.getData(b)[0] != b || cell.getParameters(b)[0] != b) valid = false;
+      }
+   }
+
+   cout << (pooled ? "BlockPool: " : "vectors:   ") << "max live " << maxLive / 1e6 << " MB, max resident "
+        << maxResident / 1e6 << " MB (" << maxResident / maxLive << "x live), final capacity " << capacity / 1e6
+        << " MB, " << time << " s" << endl;
+   if (!valid) cerr << "ERROR: blocks changed while the containers were resized" << endl;
+
+   MPI_Finalize();
+   return valid ? 0 : 1;
+}
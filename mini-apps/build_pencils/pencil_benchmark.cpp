@@ -0,0 +1,215 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Benchmark and validation of the AMR pencil construction of Vlasiator. A
+ * periodic dccrg grid is refined in nested spheres around its center, and
+ * the pencils of all three dimensions are built with the production
+ * prepareSeedIdsAndPencils (getSeedIds, buildPencilsWithNeighbors and
+ * check_ghost_cells, and classifyInteriorPencils as with
+ * vlasovsolver.translationOverlap). The build is timed, and checkPencils
+ * verifies that the pencils cover every local cell exactly once. The number of
+ * pencil cells that are propagated during the ghost cell transfer is reported.
+ * The program returns nonzero if the validation fails on any process.
+ *
+ * Usage: mpirun -n N pencil_benchmark [level 0 cells per dimension] [refinement levels]
+ *                                     [radius of the level 1 region / domain length] [repetitions]
+ *
+ * E.g. 64 cells per dimension with 3 levels and radius 0.3 gives about 10^6 cells.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mpi.h>
+
+#include "../../spatial_cell.hpp"
+#include "../../object_wrapper.h"
+#include "../../sysboundary/sysboundary.h"
+#include "../../fieldtracing/fieldtracing.h"
+#include "../../vlasovsolver/cpu_trans_map.hpp"
+#include "../../vlasovsolver/cpu_trans_map_amr.hpp"
+
+using namespace std;
+using namespace spatial_cell;
+
+Logger logFile,diagnostic;
+int globalflags::bailingOut=0;
+bool globalflags::writeRestart=0;
+bool globalflags::balanceLoad=0;
+bool globalflags::doRefine=0;
+bool globalflags::ionosphereJustSolved = false;
+ObjectWrapper objectWrapper;
+ObjectWrapper& getObjectWrapper() {
+   return objectWrapper;
+}
+
+// Boundaries and field tracing are not part of this benchmark
+SysBoundary::SysBoundary() {}
+SysBoundary::~SysBoundary() {}
+namespace FieldTracing {
+   FieldTracingParameters fieldTracingParameters;
+}
+
+// The local cell cache of Vlasiator is in vlasiator.cpp
+const vector<CellID>& getLocalCells() {
+   return Parameters::localCells;
+}
+
+/** Add the translation neighborhoods the pencil builder uses, with the same
+ * stencil depth as initializeStencils in grid.cpp uses with spatial AMR.*/
+void addTranslationNeighborhoods(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, const int stencilDepth) {
+   typedef dccrg::Types<3>::neighborhood_item_t neigh_t;
+   const int solverIds[3] = {VLASOV_SOLVER_X_NEIGHBORHOOD_ID, VLASOV_SOLVER_Y_NEIGHBORHOOD_ID, VLASOV_SOLVER_Z_NEIGHBORHOOD_ID};
+   const int targetIds[3] = {VLASOV_SOLVER_TARGET_X_NEIGHBORHOOD_ID, VLASOV_SOLVER_TARGET_Y_NEIGHBORHOOD_ID, VLASOV_SOLVER_TARGET_Z_NEIGHBORHOOD_ID};
+   for (int dimension = 0; dimension < 3; ++dimension) {
+      std::vector<neigh_t> solver, target;
+      for (int d = -stencilDepth; d <= stencilDepth; d++) {
+         if (d == 0) continue;
+         neigh_t item = {{0, 0, 0}};
+         item[dimension] = d;
+         solver.push_back(item);
+         if (abs(d) == 1) target.push_back(item);
+      }
+      if (!mpiGrid.add_neighborhood(solverIds[dimension], solver) ||
+          !mpiGrid.add_neighborhood(targetIds[dimension], target)) {
+         cerr << "Failed to add the translation neighborhoods of dimension " << dimension << endl;
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+}
+
+int main(int argn,char* args[]) {
+   int provided;
+   MPI_Init_thread(&argn,&args,MPI_THREAD_FUNNELED,&provided);
+   int myRank;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+
+   const uint cellsPerDim = (argn > 1) ? atoi(args[1]) : 32;
+   const int refLevels = (argn > 2) ? atoi(args[2]) : 2;
+   const Real radius = (argn > 3) ? atof(args[3]) : 0.3;
+   const int repetitions = (argn > 4) ? atoi(args[4]) : 3;
+
+   phiprof::initialize();
+
+   P::xcells_ini = P::ycells_ini = P::zcells_ini = cellsPerDim;
+   P::xmin = P::ymin = P::zmin = 0.0;
+   P::xmax = P::ymax = P::zmax = 1.0;
+   P::dx_ini = P::dy_ini = P::dz_ini = 1.0 / cellsPerDim;
+   P::amrMaxSpatialRefLevel = refLevels;
+   P::amrMaxAllowedSpatialRefLevel = refLevels;
+   P::vlasovTranslationOverlap = true;
+
+   // The stencil is widened by the same amount as in grid.cpp, so that a
+   // fine cell reaches VLASOV_STENCIL_WIDTH coarse cells
+   const int stencilDepth = (refLevels > 0) ? 2 * VLASOV_STENCIL_WIDTH - 1 : VLASOV_STENCIL_WIDTH;
+
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry> mpiGrid;
+   const std::array<uint64_t, 3> gridLength = {{cellsPerDim, cellsPerDim, cellsPerDim}};
+   dccrg::Cartesian_Geometry::Parameters geomParams;
+   for (int d = 0; d < 3; ++d) {
+      geomParams.start[d] = 0.0;
+      geomParams.level_0_cell_length[d] = 1.0 / cellsPerDim;
+   }
+   mpiGrid.set_initial_length(gridLength)
+      .set_load_balancing_method("RCB")
+      .set_neighborhood_length(stencilDepth)
+      .set_maximum_refinement_level(refLevels)
+      .set_periodic(true, true, true)
+      .initialize(MPI_COMM_WORLD)
+      .set_geometry(geomParams);
+
+   // Refine nested spheres around the center of the domain, the radius of
+   // each level is 70% of the previous one
+   SpatialCell::set_mpi_transfer_type(Transfer::CELL_SYSBOUNDARYFLAG);
+   double t1 = MPI_Wtime();
+   for (int level = 0; level < refLevels; ++level) {
+      const Real levelRadius = radius * pow(0.7, level);
+      for (CellID id : mpiGrid.get_cells()) {
+         if (mpiGrid.get_refinement_level(id) != level) continue;
+         const std::array<double, 3> center = mpiGrid.get_center(id);
+         const Real r2 = (center[0] - 0.5) * (center[0] - 0.5) + (center[1] - 0.5) * (center[1] - 0.5) + (center[2] - 0.5) * (center[2] - 0.5);
+         if (r2 < levelRadius * levelRadius) {
+            mpiGrid.refine_completely(id);
+         }
+      }
+      mpiGrid.stop_refining(true);
+      mpiGrid.balance_load();
+   }
+   addTranslationNeighborhoods(mpiGrid, stencilDepth);
+   Parameters::localCells = mpiGrid.get_cells();
+   const double refineTime = MPI_Wtime() - t1;
+
+   // All cells are normal cells, boundaries are not part of this benchmark
+   for (CellID id : Parameters::localCells) {
+      mpiGrid[id]->sysBoundaryFlag = sysboundarytype::NOT_SYSBOUNDARY;
+      mpiGrid[id]->sysBoundaryLayer = 0;
+   }
+   mpiGrid.update_copies_of_remote_neighbors();
+
+   uint64_t cellCounts[2] = {Parameters::localCells.size(), Parameters::localCells.size()};
+   uint64_t totalCells, maxCells;
+   MPI_Reduce(&cellCounts[0], &totalCells, 1, MPI_UINT64_T, MPI_SUM, MASTER_RANK, MPI_COMM_WORLD);
+   MPI_Reduce(&cellCounts[1], &maxCells, 1, MPI_UINT64_T, MPI_MAX, MASTER_RANK, MPI_COMM_WORLD);
+   if (myRank == MASTER_RANK) {
+      cout << "Grid of " << totalCells << " cells with " << refLevels << " refinement levels, at most "
+           << maxCells << " cells per process, built in " << refineTime << " s" << endl;
+   }
+
+   bool allValid = true;
+   for (uint dimension = 0; dimension < 3; ++dimension) {
+      double minTime = 1e300;
+      for (int r = 0; r < repetitions; ++r) {
+         MPI_Barrier(MPI_COMM_WORLD);
+         t1 = MPI_Wtime();
+         prepareSeedIdsAndPencils(mpiGrid, dimension);
+         minTime = min(minTime, MPI_Wtime() - t1);
+      }
+      const setOfPencils& pencils = getPencils(dimension);
+
+      int valid = checkPencils(mpiGrid, Parameters::localCells, pencils);
+      int allValidDimension;
+      MPI_Allreduce(&valid, &allValidDimension, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+      allValid = allValid && allValidDimension;
+
+      double maxTime;
+      uint64_t counts[3] = {pencils.N, pencils.sumOfLengths, 0};
+      for (uint pencili = 0; pencili < pencils.N; ++pencili) {
+         if (pencils.interior[pencili]) {
+            counts[2] += pencils.lengthOfPencils[pencili];
+         }
+      }
+      uint64_t totalCounts[3];
+      MPI_Reduce(&minTime, &maxTime, 1, MPI_DOUBLE, MPI_MAX, MASTER_RANK, MPI_COMM_WORLD);
+      MPI_Reduce(counts, totalCounts, 3, MPI_UINT64_T, MPI_SUM, MASTER_RANK, MPI_COMM_WORLD);
+      if (myRank == MASTER_RANK) {
+         cout << "Dimension " << dimension << ": " << totalCounts[0] << " pencils, " << totalCounts[1]
+              << " pencil cells of which " << totalCounts[2] << " interior, built in " << maxTime
+              << " s (slowest process, best of " << repetitions << "), "
+              << (allValidDimension ? "valid" : "INVALID") << endl;
+      }
+   }
+
+   phiprof::print(MPI_COMM_WORLD,"phiprof_pencils");
+   MPI_Finalize();
+   return allValid ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Test and benchmark of ConcurrentOpenBucketHashtable. All threads insert
+ * block IDs with many duplicates into one table starting from its minimum
+ * size, so that the table is migrated many times during the inserts. Each
+ * insert is immediately followed by finds of the inserted key and of a key
+ * inserted before the parallel region. At the end, every key must have been
+ * inserted exactly once and all threads must have got the value of that
+ * insert. The insert time is compared to OpenBucketHashtable on one thread.
+ * The program returns nonzero if the test fails.
+ *
+ * Usage: OMP_NUM_THREADS=8 concurrent_hashtable_test [inserts] [repetitions]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <omp.h>
+
+#include "concurrent_open_bucket_hashtable.h"
+
+using namespace std;
+
+typedef vmesh::GlobalID GID;
+typedef vmesh::LocalID LID;
+
+/* Keys from a 64-bit mix of the index, about half of them duplicates */
+GID keyOf(const size_t i, const size_t range) {
+   uint64_t x = i * 0x9E3779B97F4A7C15ull;
+   x ^= x >> 29;
+   x *= 0xBF58476D1CE4E5B9ull;
+   x ^= x >> 32;
+   return (GID)(x % range);
+}
+
+int main(int argn, char* args[]) {
+   const size_t nInserts = (argn > 1) ? atol(args[1]) : 2000000;
+   const int repetitions = (argn > 2) ? atoi(args[2]) : 5;
+   const size_t range = nInserts;
+   const size_t nPreinserted = 1000;
+
+   vector<GID> keys(nInserts);
+   for (size_t i = 0; i < nInserts; i++) keys[i] = keyOf(i, range);
+
+   double serialTime = 1e300, concurrentTime = 1e300;
+   size_t nErrors = 0;
+   for (int r = 0; r < repetitions; r++) {
+      double t1 = omp_get_wtime();
+      OpenBucketHashtable<GID, LID> serial;
+      for (size_t i = 0; i < nInserts; i++) serial.insert(make_pair(keys[i], (LID)i));
+      serialTime = min(serialTime, omp_get_wtime() - t1);
+
+      ConcurrentOpenBucketHashtable<GID, LID> table;
+      // Keys outside the range of the inserted keys, found during the inserts
+      for (size_t i = 0; i < nPreinserted; i++) table.insert(make_pair((GID)(range + i), (LID)i));
+
+      vector<LID> values(nInserts);
+      vector<uint8_t> inserted(nInserts);
+      t1 = omp_get_wtime();
+      #pragma omp parallel for schedule(dynamic, 256) reduction(+:nErrors)
+      for (size_t i = 0; i < nInserts; i++) {
+         const std::pair<LID, bool> result = table.insert(make_pair(keys[i], (LID)i));
+         values[i] = result.first;
+         inserted[i] = result.second;
+         LID value;
+         if (!table.find(keys[i], value) || value != result.first) nErrors++;
+         if (!table.find((GID)(range + i % nPreinserted), value) || value != i % nPreinserted) nErrors++;
+      }
+      concurrentTime = min(concurrentTime, omp_get_wtime() - t1);
+      table.finishMigration();
+
+      // Every key is inserted once, and all its inserts return the value of that insert
+      vector<LID> firstValue(range, vmesh::INVALID_LOCALID);
+      size_t nInserted = 0;
+      for (size_t i = 0; i < nInserts; i++) {
+         if (inserted[i]) {
+            nInserted++;
+            if (values[i] != i || firstValue[keys[i]] != vmesh::INVALID_LOCALID) nErrors++;
+            firstValue[keys[i]] = i;
+         }
+      }
+      for (size_t i = 0; i < nInserts; i++) {
+         LID value;
+         if (values[i] != firstValue[keys[i]] || !table.find(keys[i], value) || value != values[i]) nErrors++;
+      }
+      if (nInserted != serial.size() || table.size() != serial.size() + nPreinserted) nErrors++;
+   }
+
+   cout << nInserts << " inserts on " << omp_get_max_threads() << " threads" << endl;
+   cout << "OpenBucketHashtable, one thread:      " << serialTime << " s" << endl;
+   cout << "ConcurrentOpenBucketHashtable:        " << concurrentTime << " s (including two finds per insert), speedup "
+        << serialTime / concurrentTime << endl;
+   if (nErrors > 0) {
+      cerr << "ERROR: " << nErrors << " inconsistent inserts or finds" << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "open_bucket_hashtable.h"
+
+// Concurrent variant of OpenBucketHashtable, for inserting into and looking up
+// from one table with several threads at the same time. A key and its value
+// are packed into one 64-bit word, so that an entry is inserted with a single
+// compare-and-swap and is never seen half written. Entries can not be erased
+// or modified concurrently, the value of a key is the value of its first insert.
+//
+// When the buckets of a key overflow, a table of twice the size is allocated
+// and the entries are migrated to it incrementally: each thread that inserts
+// during the migration moves a chunk of buckets and the buckets of its own
+// key, and the other threads keep inserting and finding meanwhile. A migrated
+// bucket is marked as moved, finds that meet a moved bucket continue in the
+// next table. Old tables are freed only by clear() and the destructor, as
+// other threads may still be reading them.
+template <typename GID, typename LID, int maxBucketOverflow = 8, GID EMPTYBUCKET = vmesh::INVALID_GLOBALID>
+class ConcurrentOpenBucketHashtable {
+   static_assert(std::is_integral<GID>::value && std::is_integral<LID>::value && sizeof(GID) <= 4 && sizeof(LID) <= 4,
+                 "ConcurrentOpenBucketHashtable packs a key and a value into one 64-bit word");
+
+private:
+   static constexpr uint64_t EMPTY = (uint64_t)EMPTYBUCKET << 32;
+   static constexpr uint64_t MOVED = EMPTY | 1; // Not a valid entry, as no entry has the key EMPTYBUCKET
+   static constexpr size_t migrationChunk = 1024; // Buckets migrated per call of helpMigrate
+
+   struct Table {
+      int sizePower;
+      std::vector<std::atomic<uint64_t>> buckets;
+      std::atomic<Table*> next {nullptr};       // Table the entries are migrated to, if a migration has started
+      std::atomic<size_t> migrationCursor {0};  // First bucket not yet claimed by helpMigrate
+      std::atomic<size_t> migrated {0};         // Number of buckets marked as moved
+
+      Table(const int sizePower) : sizePower(sizePower), buckets(size_t(1) << sizePower) {
+         for (auto& b : buckets) b.store(EMPTY, std::memory_order_relaxed);
+      }
+   };
+
+   Table* first;                 // Oldest table, the tables are chained with next
+   std::atomic<Table*> current;  // Newest table that is not being migrated from
+   std::atomic<size_t> fill;     // Number of inserted entries
+
+   static uint64_t pack(const GID key, const LID value) { return ((uint64_t)key << 32) | (uint64_t)(uint32_t)value; }
+   static GID keyOf(const uint64_t entry) { return (GID)(entry >> 32); }
+   static LID valueOf(const uint64_t entry) { return (LID)(uint32_t)entry; }
+
+   // Fibonacci hash function, as in OpenBucketHashtable
+   static uint32_t hash(GID in, const int sizePower) {
+      in ^= in >> (32 - sizePower);
+      uint32_t retval = (uint64_t)(in * 2654435769ul) >> (32 - sizePower);
+      return retval;
+   }
+
+   void freeTables() {
+      while (first != nullptr) {
+         Table* n = first->next.load();
+         delete first;
+         first = n;
+      }
+   }
+
+   // Get the table the entries of t are migrated to, allocating it if the migration has not started yet
+   Table* startMigration(Table* t) {
+      Table* n = t->next.load(std::memory_order_acquire);
+      if (n != nullptr) {
+         return n;
+      }
+      if (t->sizePower + 1 > 31) {
+         throw std::out_of_range("ConcurrentOpenBucketHashtable ran into rehashing catastrophe and exceeded 32bit buckets.");
+      }
+      Table* candidate = new Table(t->sizePower + 1);
+      if (t->next.compare_exchange_strong(n, candidate, std::memory_order_acq_rel)) {
+         return candidate;
+      }
+      // Another thread started the migration first
+      delete candidate;
+      return n;
+   }
+
+   // Move one bucket of t to the next table. Returns true if this call marked the bucket as moved.
+   bool migrateBucket(Table* t, const size_t index) {
+      std::atomic<uint64_t>& bucket = t->buckets[index];
+      uint64_t entry = bucket.load(std::memory_order_acquire);
+      while (entry != MOVED) {
+         if (entry != EMPTY) {
+            // Copy before marking, so that a find never misses the entry. The entry can
+            // not change any more, other than to moved by another thread copying it too.
+            insertInto(t->next.load(std::memory_order_acquire), keyOf(entry), valueOf(entry), false);
+         }
+         if (bucket.compare_exchange_weak(entry, MOVED, std::memory_order_acq_rel)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   // Account for buckets of t marked as moved, and retire t once all of them are
+   void addMigrated(Table* t, const size_t count) {
+      if (count == 0) return;
+      if (t->migrated.fetch_add(count, std::memory_order_acq_rel) + count == t->buckets.size()) {
+         advanceCurrent();
+      }
+   }
+
+   // Move current past the tables that are completely migrated
+   void advanceCurrent() {
+      Table* t = current.load(std::memory_order_acquire);
+      while (t->next.load(std::memory_order_acquire) != nullptr &&
+             t->migrated.load(std::memory_order_acquire) == t->buckets.size()) {
+         Table* n = t->next.load(std::memory_order_acquire);
+         if (!current.compare_exchange_strong(t, n, std::memory_order_acq_rel)) {
+            continue; // t was updated to the current value
+         }
+         t = n;
+      }
+   }
+
+   // Migrate the next unclaimed chunk of buckets of t
+   void helpMigrate(Table* t) {
+      const size_t size = t->buckets.size();
+      const size_t start = t->migrationCursor.fetch_add(migrationChunk, std::memory_order_relaxed);
+      if (start >= size) return;
+      size_t count = 0;
+      for (size_t i = start; i < std::min(start + migrationChunk, size); i++) {
+         if (migrateBucket(t, i)) count++;
+      }
+      addMigrated(t, count);
+   }
+
+   // Insert into table t or into the tables after it. Returns the value of the key, and whether it was inserted.
+   std::pair<LID, bool> insertInto(Table* t, const GID key, const LID value, const bool countFill) {
+      while (true) {
+         Table* n = t->next.load(std::memory_order_acquire);
+         if (n != nullptr) {
+            // t is being migrated. Move the buckets of this key first, so that no other
+            // thread can insert the key into t any more, then continue in the next table.
+            helpMigrate(t);
+            const uint32_t bitMask = (1u << t->sizePower) - 1;
+            const uint32_t hashIndex = hash(key, t->sizePower);
+            size_t count = 0;
+            for (int i = 0; i < maxBucketOverflow; i++) {
+               if (migrateBucket(t, (hashIndex + i) & bitMask)) count++;
+            }
+            addMigrated(t, count);
+            t = n;
+            continue;
+         }
+
+         const uint32_t bitMask = (1u << t->sizePower) - 1;
+         const uint32_t hashIndex = hash(key, t->sizePower);
+         bool moved = false;
+         for (int i = 0; i < maxBucketOverflow && !moved; i++) {
+            std::atomic<uint64_t>& bucket = t->buckets[(hashIndex + i) & bitMask];
+            uint64_t entry = bucket.load(std::memory_order_acquire);
+            while (true) {
+               if (entry == MOVED) {
+                  // A migration started meanwhile
+                  moved = true;
+                  break;
+               }
+               if (entry != EMPTY) {
+                  if (keyOf(entry) == key) {
+                     return std::pair<LID, bool>(valueOf(entry), false);
+                  }
+                  break; // Occupied by another key, try the next bucket
+               }
+               // Buckets are only filled, so all threads inserting this key compete for the same empty bucket
+               if (bucket.compare_exchange_weak(entry, pack(key, value), std::memory_order_acq_rel)) {
+                  if (countFill) fill.fetch_add(1, std::memory_order_relaxed);
+                  return std::pair<LID, bool>(value, true);
+               }
+            }
+         }
+
+         if (!moved) {
+            // All buckets of this key are taken by other keys, so we need to migrate to a larger table.
+            startMigration(t);
+         }
+      }
+   }
+
+public:
+   ConcurrentOpenBucketHashtable(const int sizePower = 4) : first(new Table(sizePower)), current(first), fill(0) {}
+
+   ConcurrentOpenBucketHashtable(const ConcurrentOpenBucketHashtable&) = delete;
+   ConcurrentOpenBucketHashtable& operator=(const ConcurrentOpenBucketHashtable&) = delete;
+
+   ~ConcurrentOpenBucketHashtable() { freeTables(); }
+
+   // Insert an entry if the key does not exist yet. Thread-safe. Returns the value
+   // of the key and true if it was inserted, or the existing value and false.
+   std::pair<LID, bool> insert(std::pair<GID, LID> newEntry) {
+      assert(newEntry.first != EMPTYBUCKET);
+      return insertInto(current.load(std::memory_order_acquire), newEntry.first, newEntry.second, true);
+   }
+
+   // Find the value of a key. Thread-safe, also during inserts. Returns false if the key does not exist.
+   bool find(const GID& key, LID& value) const {
+      for (const Table* t = current.load(std::memory_order_acquire); t != nullptr; t = t->next.load(std::memory_order_acquire)) {
+         const uint32_t bitMask = (1u << t->sizePower) - 1;
+         const uint32_t hashIndex = hash(key, t->sizePower);
+         for (int i = 0; i < maxBucketOverflow; i++) {
+            const uint64_t entry = t->buckets[(hashIndex + i) & bitMask].load(std::memory_order_acquire);
+            if (entry == EMPTY) {
+               break; // Not in this table, but it may have been inserted into the next one
+            }
+            if (entry != MOVED && keyOf(entry) == key) {
+               value = valueOf(entry);
+               return true;
+            }
+         }
+      }
+      return false;
+   }
+
+   size_t count(const GID& key) const {
+      LID value;
+      return find(key, value) ? 1 : 0;
+   }
+
+   // Number of entries. Exact when no inserts are in progress.
+   size_t size() const { return fill.load(std::memory_order_acquire); }
+
+   size_t bucket_count() const { return current.load(std::memory_order_acquire)->buckets.size(); }
+
+   // Complete an ongoing migration. Thread-safe, but meant to be called once all
+   // threads have finished inserting, e.g. after an omp barrier.
+   void finishMigration() {
+      Table* t = current.load(std::memory_order_acquire);
+      while (t->next.load(std::memory_order_acquire) != nullptr) {
+         while (t->migrationCursor.load(std::memory_order_relaxed) < t->buckets.size()) {
+            helpMigrate(t);
+         }
+         t = t->next.load(std::memory_order_acquire);
+      }
+   }
+
+   // Remove all entries and free the old tables, keeping the size of the current
+   // table. Not thread-safe.
+   void clear() {
+      const int sizePower = current.load()->sizePower;
+      freeTables();
+      first = new Table(sizePower);
+      current.store(first);
+      fill.store(0);
+   }
+
+   // Make room for at least n entries without migrations. Not thread-safe,
+   // and only valid for an empty table.
+   void reserve(const size_t n) {
+      assert(size() == 0);
+      int sizePower = current.load()->sizePower;
+      while ((size_t(1) << sizePower) < 2 * n) sizePower++;
+      if (sizePower > current.load()->sizePower) {
+         freeTables();
+         first = new Table(sizePower);
+         current.store(first);
+      }
+   }
+};
@@ -0,0 +1,137 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Test of the vector backends of vec.h. The program evaluates the basic
+ * operations of Vec and the PLM, PPM and PQM reconstructions of the
+ * semi-Lagrangian solvers on a fixed set of pseudo-random columns, and
+ * prints all results as hexadecimal floating point numbers. The output of
+ * a backend is compared against the output of the fallback of the same
+ * length and precision with "make check", they must be bitwise identical.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "common.h"
+#include "vlasovsolver/vec.h"
+#include "vlasovsolver/cpu_1d_plm.hpp"
+#include "vlasovsolver/cpu_1d_ppm.hpp"
+#include "vlasovsolver/cpu_1d_pqm.hpp"
+
+const uint CELLS = 64;       /*!< Number of cells in a test column.*/
+const uint COLUMNS = 32;     /*!< Number of test columns.*/
+const Realv threshold = 1.0e-15;
+
+/* Linear congruential generator, so that all backends see the same
+   values regardless of the standard library.*/
+static uint64_t state = 12345;
+Realv nextValue() {
+   state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+   return (Realv)((state >> 11) * (1.0 / 9007199254740992.0));
+}
+
+void print(const char* name, const Vec& v) {
+   printf("%s", name);
+   for (int i = 0; i < VECL; ++i) printf(" %a", (double)v[i]);
+   printf("\n");
+}
+
+void print(const char* name, const Veci& v) {
+   printf("%s", name);
+   for (int i = 0; i < VECL; ++i) printf(" %d", (int)v[i]);
+   printf("\n");
+}
+
+/* Column of a distribution with sparse regions, sharp peaks and values
+   close to the threshold, padded with WID cells on both sides.*/
+void fillColumn(Vec* values) {
+   Realv column[(CELLS + 2*WID) * VECL];
+   for (uint c = 0; c < (CELLS + 2*WID) * VECL; ++c) {
+      const Realv r = nextValue();
+      if (r < 0.2) column[c] = 0.0;
+      else if (r < 0.3) column[c] = threshold * 10 * nextValue();
+      else if (r < 0.35) column[c] = 1.0e3 * nextValue();
+      else column[c] = nextValue();
+   }
+   for (uint k = 0; k < CELLS + 2*WID; ++k) values[k].load(column + k * VECL);
+}
+
+void testOperations(const Vec* values) {
+   for (uint k = 1; k < CELLS + 2*WID; ++k) {
+      const Vec a = values[k - 1];
+      const Vec b = values[k];
+      print("sum", a + b);
+      print("difference", a - b);
+      print("product", a * b);
+      print("quotient", a / b);
+      print("scalar", 1.0 / 6.0 * a - 7.0 / 12.0 + 2 * b);
+      print("scalar_left", 0.1 - a);
+      print("negation", -a);
+      print("min", min(a, b));
+      print("min_scalar", min(0.5, b));
+      print("max", max(a, b));
+      print("max_scalar", max(a, 0.5));
+      print("abs", abs(a - b));
+      print("sqrt", sqrt(a));
+      print("select", select(a < b || a == 0.0, a * two, b - half));
+      print("select_scalar", select(!(a >= 0.5) && b > 0.25, 1.0, b));
+      print("truncate", truncate_to_int(a * 100.0));
+      print("to_realv", to_realv(truncate_to_int(b * 10.0)));
+      Vec c = a;
+      c += b;
+      c -= 0.125;
+      print("update", c);
+      printf("horizontal %d %d\n", (int)horizontal_or(a > 0.9), (int)horizontal_and(a > 0.1));
+   }
+}
+
+void testReconstructions(Vec* values) {
+   for (uint k = WID; k < CELLS + WID; ++k) {
+      Vec a[5];
+      compute_plm_coeff(values, k, a, threshold);
+      print("plm_0", a[0]);
+      print("plm_1", a[1]);
+      compute_ppm_coeff(values, h4, k, a, threshold);
+      print("ppm_h4_0", a[0]);
+      print("ppm_h4_1", a[1]);
+      print("ppm_h4_2", a[2]);
+      compute_ppm_coeff(values, h6, k, a, threshold);
+      print("ppm_h6_0", a[0]);
+      print("ppm_h6_1", a[1]);
+      print("ppm_h6_2", a[2]);
+      compute_pqm_coeff(values, h8, k, a, threshold);
+      for (int i = 0; i < 5; ++i) {
+         char name[16];
+         snprintf(name, sizeof(name), "pqm_h8_%d", i);
+         print(name, a[i]);
+      }
+   }
+}
+
+int main(int argn, char* args[]) {
+   Vec values[CELLS + 2*WID];
+   for (uint column = 0; column < COLUMNS; ++column) {
+      fillColumn(values);
+      testOperations(values);
+      testReconstructions(values);
+   }
+   return 0;
+}
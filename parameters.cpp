@@ -140,6 +140,17 @@ vector<string> P::diagnosticVariableList;
 string P::projectName = string("");
 
 bool P::vlasovAccelerateMaxwellianBoundaries = false;
+int P::vlasovAccelerationReconstruction = accReconstruction::PQM;
+bool P::vlasovAccelerationFused = false;
+uint P::vlasovAccelerationFusedMaxBoxBlocks = 512;
+Real P::vlasovAccelerationFusedMaxBoxRatio = 8.0;
+bool P::vlasovAccelerationSortIndex = false;
+bool P::vlasovAccelerationSkipIsotropic = false;
+Real P::vlasovAccelerationSkipAnisotropy = 1.0e-3;
+Real P::vlasovAccelerationSkipShift = 0.01;
+bool P::vlasovTranslationOverlap = false;
+bool P::vlasovTranslationStrang = false;
+bool P::vlasovBlockPool = false;
 Real P::maxSlAccelerationRotation = 10.0;
 Real P::hallMinimumRhom = physicalconstants::MASS_PROTON;
 Real P::hallMinimumRhoq = physicalconstants::CHARGE;
@@ -367,6 +378,62 @@ bool P::addParameters() {
    RP::add("vlasovsolver.accelerateMaxwellianBoundaries",
            "Propagate maxwellian boundary cell contents in velocity space. Default false.",
            false);
+#if defined(ACC_SEMILAG_PLM)
+   const std::string accReconstructionDefault = "PLM";
+#elif defined(ACC_SEMILAG_PPM)
+   const std::string accReconstructionDefault = "PPM";
+#else
+   const std::string accReconstructionDefault = "PQM";
+#endif
+   RP::add("vlasovsolver.accelerationReconstruction",
+           "Reconstruction used in the semi-Lagrangian acceleration (options are: PLM, PPM, PQM). Defaults to the one "
+           "selected at compile time with ACC_SEMILAG_*.",
+           accReconstructionDefault);
+   RP::add("vlasovsolver.accelerationFused",
+           "Do the three 1D mappings of each acceleration subcycle in a dense velocity box that is copied from and "
+           "back into the velocity blocks once, instead of mapping the blocks directly three times. Cells whose box "
+           "is too large are mapped as usual. Default false.",
+           false);
+   RP::add("vlasovsolver.accelerationFusedMaxBoxBlocks",
+           "Maximum number of velocity blocks in the velocity box of a cell with accelerationFused. The default 512 "
+           "keeps a box of double precision vectors within 1 MiB, about the size of an L2 cache.",
+           512);
+   RP::add("vlasovsolver.accelerationFusedMaxBoxRatio",
+           "Maximum ratio of the number of velocity blocks in the velocity box to the number of blocks in the cell "
+           "with accelerationFused. Default 8.",
+           8.0);
+   RP::add("vlasovsolver.accelerationSortIndex",
+           "Keep the velocity blocks of each cell sorted along each dimension between acceleration steps, and patch "
+           "the sorted lists with the added and removed blocks instead of sorting all blocks again. Costs about 24 "
+           "bytes of memory per velocity block. Default false.",
+           false);
+   RP::add("vlasovsolver.accelerationSkipIsotropic",
+           "Skip the acceleration of a population whose distribution is isotropic around its bulk velocity when the "
+           "acceleration transform only rotates it around the bulk velocity, as for a cold population gyrating in a "
+           "magnetic field without an electric field in its rest frame. Default false.",
+           false);
+   RP::add("vlasovsolver.accelerationSkipAnisotropy",
+           "Maximum product of the pressure anisotropy |P - p I| / p and the rotation angle (radians) of the "
+           "acceleration transform of a population whose acceleration is skipped.",
+           1.0e-3);
+   RP::add("vlasovsolver.accelerationSkipShift",
+           "Maximum shift of the bulk velocity by the acceleration transform of a population whose acceleration is "
+           "skipped, as a fraction of the velocity cell size.",
+           0.01);
+   RP::add("vlasovsolver.translationOverlap",
+           "With spatial AMR, split the pencils into segments and propagate the segments whose source cells are all local "
+           "while the stencil data of the remote cells is being transferred, and the remaining segments after the "
+           "transfer. Default false.",
+           false);
+   RP::add("vlasovsolver.translationStrang",
+           "Translate the dimensions in the order z, x, y on even time steps and y, x, z on odd time steps, "
+           "instead of always z, x, y. Default false.",
+           false);
+   RP::add("vlasovsolver.blockPool",
+           "Store the velocity blocks of the cells of a process in slots of a process-wide pool of reserved address "
+           "space. Cells grow in place without copying their blocks, and the memory of shrunk and removed blocks is "
+           "returned to the system immediately. Default false.",
+           false);
 
    // Load balancing parameters
    RP::add("loadBalance.algorithm", "Load balancing algorithm to be used", string("RCB"));
@@ -921,6 +988,28 @@ void Parameters::getParameters() {
    RP::get("vlasovsolver.maxCFL", P::vlasovSolverMaxCFL);
    RP::get("vlasovsolver.minCFL", P::vlasovSolverMinCFL);
    RP::get("vlasovsolver.accelerateMaxwellianBoundaries",  P::vlasovAccelerateMaxwellianBoundaries);
+   std::string accReconstructionString;
+   RP::get("vlasovsolver.accelerationReconstruction", accReconstructionString);
+   if (accReconstructionString == "PLM") {
+      P::vlasovAccelerationReconstruction = accReconstruction::PLM;
+   } else if (accReconstructionString == "PPM") {
+      P::vlasovAccelerationReconstruction = accReconstruction::PPM;
+   } else if (accReconstructionString == "PQM") {
+      P::vlasovAccelerationReconstruction = accReconstruction::PQM;
+   } else {
+      cerr << "Unknown acceleration reconstruction " << accReconstructionString << " in " << __FILE__ << ":" << __LINE__ << endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   RP::get("vlasovsolver.accelerationFused", P::vlasovAccelerationFused);
+   RP::get("vlasovsolver.accelerationFusedMaxBoxBlocks", P::vlasovAccelerationFusedMaxBoxBlocks);
+   RP::get("vlasovsolver.accelerationFusedMaxBoxRatio", P::vlasovAccelerationFusedMaxBoxRatio);
+   RP::get("vlasovsolver.accelerationSortIndex", P::vlasovAccelerationSortIndex);
+   RP::get("vlasovsolver.accelerationSkipIsotropic", P::vlasovAccelerationSkipIsotropic);
+   RP::get("vlasovsolver.accelerationSkipAnisotropy", P::vlasovAccelerationSkipAnisotropy);
+   RP::get("vlasovsolver.accelerationSkipShift", P::vlasovAccelerationSkipShift);
+   RP::get("vlasovsolver.translationOverlap", P::vlasovTranslationOverlap);
+   RP::get("vlasovsolver.translationStrang", P::vlasovTranslationStrang);
+   RP::get("vlasovsolver.blockPool", P::vlasovBlockPool);
 
    // Get load balance parameters
    RP::get("loadBalance.algorithm", P::loadBalanceAlgorithm);
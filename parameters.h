@@ -148,6 +148,25 @@ struct Parameters {
    static Real maxSlAccelerationRotation; /*!< Maximum rotation in acceleration for semilagrangian solver*/
    static int maxSlAccelerationSubcycles; /*!< Maximum number of subcycles in acceleration*/
    static bool vlasovAccelerateMaxwellianBoundaries; /*!< Accelerate also Maxwellian boundary cells*/
+   static int vlasovAccelerationReconstruction; /*!< Reconstruction used in acceleration, one of the values defined in
+                                                  * accReconstruction::Order. Defaults to the compile time ACC_SEMILAG_* choice.*/
+   static bool vlasovAccelerationFused; /*!< Do the three mappings of an acceleration subcycle in a dense velocity box.*/
+   static uint vlasovAccelerationFusedMaxBoxBlocks; /*!< Maximum number of blocks in the velocity box of the fused mapping.*/
+   static Real vlasovAccelerationFusedMaxBoxRatio; /*!< Maximum ratio of velocity box blocks to cell blocks in the fused mapping.*/
+   static bool vlasovAccelerationSortIndex; /*!< Keep the blocks of each population sorted along each dimension between
+                                               acceleration steps, patching the lists instead of sorting again.*/
+   static bool vlasovAccelerationSkipIsotropic; /*!< Skip the acceleration of populations that are isotropic around their
+                                                   bulk velocity when the transform is a rotation around it.*/
+   static Real vlasovAccelerationSkipAnisotropy; /*!< Maximum product of the pressure anisotropy and the rotation angle
+                                                    (radians) of a skipped population.*/
+   static Real vlasovAccelerationSkipShift; /*!< Maximum shift of the bulk velocity of a skipped population, in units of
+                                               the velocity cell size.*/
+   static bool vlasovTranslationOverlap; /*!< Propagate the segments of the AMR pencils that only depend on local cells
+                                            while the ghost cells are being updated.*/
+   static bool vlasovTranslationStrang; /*!< Alternate the order of the translated dimensions between z, x, y and y, x, z
+                                           on every other time step.*/
+   static bool vlasovBlockPool; /*!< Store the velocity blocks of all cells of the process in slots of the rank-wide
+                                   vmesh::BlockPool instead of separately allocated vectors.*/
 
    static Real hallMinimumRhom; /*!< Minimum mass density value used in the field solver.*/
    static Real hallMinimumRhoq; /*!< Minimum charge density value used for the Hall and electron pressure gradient terms
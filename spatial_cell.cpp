@@ -25,6 +25,7 @@
 #include "spatial_cell.hpp"
 #include "velocity_blocks.h"
 #include "object_wrapper.h"
+#include "vlasovsolver/cpu_block_content.hpp"
 
 #ifndef NDEBUG
    #define DEBUG_SPATIAL_CELL
@@ -74,6 +75,94 @@ namespace spatial_cell {
       }
    }
 
+   #ifndef VAMR
+   /** Dense bitmap of the velocity blocks in a box of the block grid, used by
+    * adjust_velocity_blocks to collect the blocks that have content in their
+    * spatial or velocity space neighborhood. A row of the bitmap runs along
+    * vx, which is the fastest index of the global ID, with one bit per block,
+    * so that the velocity space neighborhood is added with shifts and ORs of
+    * whole words. One bitmap per thread is reused, so that in the steady state
+    * no heap allocations are done.*/
+   struct BlockBitmap {
+      vmesh::LocalID lo[3];        /*!< Indices of the first block of the box.*/
+      vmesh::LocalID n[3];         /*!< Number of blocks in the box per dimension.*/
+      size_t rowWords;             /*!< Number of 64-bit words per row.*/
+      std::vector<uint64_t> bits;  /*!< Rows of the box, y fastest.*/
+      std::vector<uint64_t> work;  /*!< Scratch rows for the dilation.*/
+
+      /** Clear the bitmap for the box [boxMin,boxMax], limits inclusive.*/
+      void reset(const vmesh::LocalID boxMin[3],const vmesh::LocalID boxMax[3]) {
+         for (int d=0; d<3; ++d) {
+            lo[d] = boxMin[d];
+            n[d] = (boxMax[d] >= boxMin[d]) ? boxMax[d] - boxMin[d] + 1 : 0;
+         }
+         rowWords = (n[0] + 63) / 64;
+         bits.assign(rowWords*n[1]*n[2],0);
+      }
+
+      uint64_t* row(std::vector<uint64_t>& rows,const vmesh::LocalID j,const vmesh::LocalID k) {
+         return rows.data() + (k*n[1] + j)*rowWords;
+      }
+
+      bool inside(const vmesh::LocalID i,const vmesh::LocalID j,const vmesh::LocalID k) const {
+         return i-lo[0] < n[0] && j-lo[1] < n[1] && k-lo[2] < n[2];
+      }
+
+      /** Set the bit of a block, the block has to be inside the box.*/
+      void set(const vmesh::LocalID i,const vmesh::LocalID j,const vmesh::LocalID k) {
+         const vmesh::LocalID x = i - lo[0];
+         row(bits,j-lo[1],k-lo[2])[x/64] |= uint64_t(1) << (x%64);
+      }
+
+      bool test(const vmesh::LocalID i,const vmesh::LocalID j,const vmesh::LocalID k) {
+         if (!inside(i,j,k)) return false;
+         const vmesh::LocalID x = i - lo[0];
+         return (row(bits,j-lo[1],k-lo[2])[x/64] >> (x%64)) & 1;
+      }
+
+      /** Set the bits of all blocks within width blocks (in each dimension,
+       * i.e., a cube) of a set bit. The box is assumed to already extend width
+       * blocks beyond the set bits, or to the edge of the velocity grid.*/
+      void dilate(const int width) {
+         if (width <= 0 || bits.empty()) return;
+         const size_t nRows = n[1]*n[2];
+         const uint64_t lastMask = (n[0]%64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (n[0]%64)) - 1;
+
+         // Along vx, in steps of one block with the carries between words
+         for (int w=0; w<width; ++w) {
+            for (size_t r=0; r<nRows; ++r) {
+               uint64_t* words = bits.data() + r*rowWords;
+               uint64_t carryUp = 0;
+               for (size_t c=0; c<rowWords; ++c) {
+                  const uint64_t word = words[c];
+                  const uint64_t next = (c+1 < rowWords) ? words[c+1] : 0;
+                  words[c] = word | (word << 1) | carryUp | (word >> 1) | (next << 63);
+                  carryUp = word >> 63;
+               }
+               words[rowWords-1] &= lastMask;
+            }
+         }
+
+         // Along vy and vz, OR of the rows within width rows
+         for (int d=1; d<3; ++d) {
+            work.assign(bits.size(),0);
+            for (vmesh::LocalID k=0; k<n[2]; ++k) for (vmesh::LocalID j=0; j<n[1]; ++j) {
+               const vmesh::LocalID pos = (d == 1) ? j : k;
+               const vmesh::LocalID first = (pos >= (vmesh::LocalID)width) ? pos - width : 0;
+               const vmesh::LocalID last = std::min<vmesh::LocalID>(pos + width, n[d] - 1);
+               uint64_t* target = row(work,j,k);
+               for (vmesh::LocalID p=first; p<=last; ++p) {
+                  const uint64_t* source = (d == 1) ? row(bits,p,k) : row(bits,j,p);
+                  for (size_t c=0; c<rowWords; ++c) target[c] |= source[c];
+               }
+            }
+            bits.swap(work);
+         }
+      }
+   };
+
+   #endif
+
    /** Adds "important" and removes "unimportant" velocity blocks
     * to/from this cell.
     * 
@@ -106,44 +195,61 @@ namespace spatial_cell {
          exit(1);
       }
       #endif
-      
-      //  This set contains all those cellids which have neighbors in any
-      //  of the 6-dimensions Actually, we would only need to add
+
+      const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = populations[popID].vmesh;
+      const vmesh::LocalID* gridLength = vmesh.getGridLength(0);
+      const int addWidthV = getObjectWrapper().particleSpecies[popID].sparseBlockAddWidthV;
+      uint8_t refLevel;
+      vmesh::LocalID i,j,k;
+
+      // Bounding box of the blocks with content in this cell, extended by
+      // the velocity space neighborhood, and of the blocks with content in
+      // the spatial neighbors
+      vmesh::LocalID boxMin[3] = {gridLength[0],gridLength[1],gridLength[2]};
+      vmesh::LocalID boxMax[3] = {0,0,0};
+      auto extendBox = [&](const vmesh::LocalID indices[3],const int width) {
+         for (int d=0; d<3; ++d) {
+            boxMin[d] = std::min<vmesh::LocalID>(boxMin[d], (indices[d] >= (vmesh::LocalID)width) ? indices[d] - width : 0);
+            boxMax[d] = std::max<vmesh::LocalID>(boxMax[d], std::min<vmesh::LocalID>(indices[d] + width, gridLength[d] - 1));
+         }
+      };
+      for (vmesh::LocalID block_index=0; block_index<velocity_block_with_content_list.size(); ++block_index) {
+         vmesh.getIndices(velocity_block_with_content_list[block_index],refLevel,i,j,k);
+         const vmesh::LocalID indices[3] = {i,j,k};
+         extendBox(indices,addWidthV);
+      }
+      for (const SpatialCell* neighbor : spatial_neighbors) {
+         for (vmesh::LocalID block_index=0; block_index<neighbor->velocity_block_with_content_list.size(); ++block_index) {
+            vmesh.getIndices(neighbor->velocity_block_with_content_list[block_index],refLevel,i,j,k);
+            const vmesh::LocalID indices[3] = {i,j,k};
+            extendBox(indices,0);
+         }
+      }
+
+      //  This bitmap contains all those blocks which have neighbors in any
+      //  of the 6-dimensions. Actually, we would only need to add
       //  local blocks with no content here, as blocks with content
       //  do not need to be created and also will not be removed as
       //  we only check for removal for blocks with no content
-      std::unordered_set<vmesh::GlobalID> neighbors_have_content;
+      static thread_local BlockBitmap neighbors_have_content;
+      neighbors_have_content.reset(boxMin,boxMax);
 
-      //add neighbor content info for velocity space neighbors to map. We loop over blocks
-      //with content and raise the neighbors_have_content for
-      //itself, and for all its neighbors
+      //add neighbor content info for velocity space neighbors. We raise
+      //the bit of each block with content, and then dilate the bitmap
+      //by sparseBlockAddWidthV to raise the bits of all its neighbors
       for (vmesh::LocalID block_index=0; block_index<velocity_block_with_content_list.size(); ++block_index) {
-         vmesh::GlobalID block = velocity_block_with_content_list[block_index];
-
-         const uint8_t refLevel=0;
-         const velocity_block_indices_t indices = SpatialCell::get_velocity_block_indices(popID,block);
-         neighbors_have_content.insert(block); //also add the cell itself
-
-         int addWidthV = getObjectWrapper().particleSpecies[popID].sparseBlockAddWidthV;
-         for (int offset_vx=-addWidthV;offset_vx<=addWidthV;offset_vx++) {
-            for (int offset_vy=-addWidthV;offset_vy<=addWidthV;offset_vy++) {
-               for (int offset_vz=-addWidthV;offset_vz<=addWidthV;offset_vz++) {
-                  const vmesh::GlobalID neighbor_block 
-                     = get_velocity_block(popID,{{indices[0]+offset_vx,indices[1]+offset_vy,indices[2]+offset_vz}},refLevel);
-                  neighbors_have_content.insert(neighbor_block); //add all potential ngbrs of this block with content
-               }
-            }
-         }
+         vmesh.getIndices(velocity_block_with_content_list[block_index],refLevel,i,j,k);
+         neighbors_have_content.set(i,j,k);
       }
+      neighbors_have_content.dilate(addWidthV);
 
-      //add neighbor content info for spatial space neighbors to map. We loop over
+      //add neighbor content info for spatial space neighbors. We loop over
       //neighbor cell lists with existing blocks, and raise the
-      //flag for the local block with same block id
-      for (std::vector<SpatialCell*>::const_iterator neighbor=spatial_neighbors.begin();
-           neighbor != spatial_neighbors.end(); ++neighbor) {
-         for (vmesh::LocalID block_index=0; block_index<(*neighbor)->velocity_block_with_content_list.size(); ++block_index) {
-            vmesh::GlobalID block = (*neighbor)->velocity_block_with_content_list[block_index];
-            neighbors_have_content.insert(block);
+      //bit for the local block with same block id
+      for (const SpatialCell* neighbor : spatial_neighbors) {
+         for (vmesh::LocalID block_index=0; block_index<neighbor->velocity_block_with_content_list.size(); ++block_index) {
+            vmesh.getIndices(neighbor->velocity_block_with_content_list[block_index],refLevel,i,j,k);
+            neighbors_have_content.set(i,j,k);
          }
       }
 
@@ -167,9 +273,8 @@ namespace spatial_cell {
             }
             #endif
             
-            bool removeBlock = false;
-            std::unordered_set<vmesh::GlobalID>::iterator it = neighbors_have_content.find(blockGID);
-            if (it == neighbors_have_content.end()) removeBlock = true;
+            vmesh.getIndices(blockGID,refLevel,i,j,k);
+            const bool removeBlock = !neighbors_have_content.test(i,j,k);
 
             if (removeBlock == true) {
                //No content, and also no neighbor have content -> remove
@@ -189,8 +294,18 @@ namespace spatial_cell {
       }
 
       // ADD all blocks with neighbors in spatial or velocity space (if it exists then the block is unchanged)
-      for (std::unordered_set<vmesh::GlobalID>::iterator it=neighbors_have_content.begin(); it != neighbors_have_content.end(); ++it) {
-         this->add_velocity_block(*it,popID);
+      for (vmesh::LocalID kb=0; kb<neighbors_have_content.n[2]; ++kb) for (vmesh::LocalID jb=0; jb<neighbors_have_content.n[1]; ++jb) {
+         const uint64_t* words = neighbors_have_content.row(neighbors_have_content.bits,jb,kb);
+         for (size_t c=0; c<neighbors_have_content.rowWords; ++c) {
+            uint64_t word = words[c];
+            while (word != 0) {
+               const vmesh::LocalID ib = c*64 + __builtin_ctzll(word);
+               word &= word - 1;
+               this->add_velocity_block(vmesh.getGlobalID(0,neighbors_have_content.lo[0]+ib,
+                                                          neighbors_have_content.lo[1]+jb,
+                                                          neighbors_have_content.lo[2]+kb),popID);
+            }
+         }
       }
    }
 
@@ -515,17 +630,8 @@ namespace spatial_cell {
       const vmesh::LocalID blockLID = get_velocity_block_local_id(blockGID,popID);
       if (blockLID == invalid_local_id()) return false;
             
-      bool has_content = false;
-      const Real velocity_block_min_value = getVelocityBlockMinValue(popID);
       const Realf* block_data = populations[popID].blockContainer.getData(blockLID);
-      for (unsigned int i=0; i<VELOCITY_BLOCK_LENGTH; ++i) {
-         if (block_data[i] >= velocity_block_min_value) {
-            has_content = true;
-            break;
-         }
-      }
-      
-      return has_content;
+      return blockHasContent(block_data,vectorThreshold(getVelocityBlockMinValue(popID)));
    }
    
    /** Get maximum translation timestep for the given species.
@@ -1261,6 +1367,7 @@ namespace spatial_cell {
    void SpatialCell::prepare_to_receive_blocks(const uint popID) {
       populations[popID].vmesh.setGrid();
       populations[popID].blockContainer.setSize(populations[popID].vmesh.size());
+      populations[popID].sortIndex.invalidate();
 
       Real* parameters = get_block_parameters(popID);
       
@@ -1292,6 +1399,7 @@ namespace spatial_cell {
       if (populations[popID].vmesh.refine(blockGID,erasedBlocks,newInserted) == false) {
          return;
       }
+      populations[popID].sortIndex.invalidate();
 
       // Resize the block container, this preserves old data.
       const size_t newBlocks = newInserted.size()-erasedBlocks.size();
@@ -1374,11 +1482,13 @@ namespace spatial_cell {
 
    /**  Purges extra capacity from block vectors. It sets size to
     * num_blocks * block_allocation_factor (if capacity greater than this), 
-    * and also forces capacity to this new smaller value.
+    * and also forces capacity to this new smaller value. Only done with
+    * vlasovsolver.blockPool, where shrinking returns the pages after the
+    * new capacity without copying the blocks.
     * @return True on success.*/
    bool SpatialCell::shrink_to_fit() {
       bool success = true;
-      return success;
+      if (!P::vlasovBlockPool) return success;
 
       for (size_t p=0; p<populations.size(); ++p) {
          const uint64_t amount 
@@ -1406,10 +1516,14 @@ namespace spatial_cell {
       
       velocity_block_with_content_list.clear();
       velocity_block_with_no_content_list.clear();
-      
+
+      // Blocks are scanned in local ID order directly from the block container,
+      // compute_block_has_content would look up each local ID from its global ID
+      const Realv threshold = vectorThreshold(getVelocityBlockMinValue(popID));
+      const Realf* block_data = populations[popID].blockContainer.getData();
       for (vmesh::LocalID block_index=0; block_index<populations[popID].vmesh.size(); ++block_index) {
          const vmesh::GlobalID globalID = populations[popID].vmesh.getGlobalID(block_index);
-         if (compute_block_has_content(globalID,popID)){
+         if (blockHasContent(block_data + block_index*WID3,threshold)) {
             velocity_block_with_content_list.push_back(globalID);
          } else {
             velocity_block_with_no_content_list.push_back(globalID);
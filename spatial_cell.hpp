@@ -55,6 +55,7 @@ Spatial cell class for Vlasiator that supports a variable number of velocity blo
 #include "vamr_refinement_criteria.h"
 #include "velocity_blocks.h"
 #include "velocity_block_container.h"
+#include "velocity_block_sort_index.h"
 
 #include "logger.h"
 extern Logger logFile;
@@ -170,6 +171,8 @@ namespace spatial_cell {
                                                                       * in this spatial cell. Cells are identified by their unique 
                                                                       * global IDs.*/
       vmesh::VelocityBlockContainer<vmesh::LocalID> blockContainer;  /**< Velocity block data.*/
+      vmesh::VelocityBlockSortIndex<vmesh::GlobalID,vmesh::LocalID> sortIndex; /**< Blocks sorted along each velocity dimension,
+                                                                      * patched with the blocks added or removed in between.*/
    };
 
    class SpatialCell {
@@ -285,6 +288,7 @@ namespace spatial_cell {
                 vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer,const uint popID);
       vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& get_velocity_mesh(const size_t& popID);
       vmesh::VelocityBlockContainer<vmesh::LocalID>& get_velocity_blocks(const size_t& popID);
+      vmesh::VelocityBlockSortIndex<vmesh::GlobalID,vmesh::LocalID>& get_velocity_block_sort_index(const size_t& popID);
       vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& get_velocity_mesh_temporary();
       vmesh::VelocityBlockContainer<vmesh::LocalID>& get_velocity_blocks_temporary();
 
@@ -1517,6 +1521,18 @@ namespace spatial_cell {
       return populations[popID].blockContainer;
    }
 
+   inline vmesh::VelocityBlockSortIndex<vmesh::GlobalID,vmesh::LocalID>& SpatialCell::get_velocity_block_sort_index(const size_t& popID) {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      #endif
+      
+      return populations[popID].sortIndex;
+   }
+
    inline vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& SpatialCell::get_velocity_mesh_temporary() {
       return vmeshTemp;
    }
@@ -1597,6 +1613,7 @@ namespace spatial_cell {
        
       populations[popID].vmesh.clear();
       populations[popID].blockContainer.clear();
+      populations[popID].sortIndex.clear();
     }
 
    /*!
@@ -1641,6 +1658,7 @@ namespace spatial_cell {
       for (size_t p=0; p<populations.size(); ++p) {
         capacity += populations[p].vmesh.capacityInBytes();
         capacity += populations[p].blockContainer.capacityInBytes();
+        capacity += populations[p].sortIndex.capacityInBytes();
       }
       
       return capacity;
@@ -1667,6 +1685,7 @@ namespace spatial_cell {
       if (populations[popID].vmesh.push_back(block) == false) {
          return false;
       }
+      populations[popID].sortIndex.added(block);
 
       const vmesh::LocalID VBC_LID = populations[popID].blockContainer.push_back();
 
@@ -1703,6 +1722,7 @@ namespace spatial_cell {
          std::cerr << "Failed to add blocks" << std::endl;
          return;
       }
+      for (size_t b=0; b<blocks.size(); ++b) populations[popID].sortIndex.added(blocks[b]);
 
       // Add blocks to block container
       vmesh::LocalID startLID = populations[popID].blockContainer.push_back(blocks.size());
@@ -1825,6 +1845,7 @@ namespace spatial_cell {
 
       populations[popID].blockContainer.copy(lastLID,removedLID);
       populations[popID].blockContainer.pop();
+      populations[popID].sortIndex.removed(block);
    }
 
    inline void SpatialCell::swap(vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
@@ -1844,6 +1865,7 @@ namespace spatial_cell {
 
       populations[popID].vmesh.swap(vmesh);
       populations[popID].blockContainer.swap(blockContainer);
+      populations[popID].sortIndex.invalidate();
    }
 
    /*!
@@ -165,6 +165,12 @@ do
             fi
         done # loop over variables
 
+        # Run test specific checks, if they exist
+        if [ -e ${vlsv_dir}/test_check.sh ]; then
+            echo "--------------------------------------------------------------------------------------------"
+            ( cd ${vlsv_dir} && ./test_check.sh "$run_command_tools $diffbin" ${reference_dir}/${reference_revision} ) || echo "${test_name[$run]}  -  test_check.sh FAILED"
+        fi
+
         echo "--------------------------------------------------------------------------------------------"
     fi
 done # loop over tests
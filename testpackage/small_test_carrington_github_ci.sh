@@ -285,8 +285,18 @@ for run in ${run_tests[*]}; do
    MAXRELVAR=`cat $RUNNER_TEMP/MAXRELVAR.txt`
    speedup=`cat $RUNNER_TEMP/speedup.txt`
 
+   # Run test specific checks, if they exist
+   CHECK_ERROR=0
+   if [ -e ${vlsv_dir}/test_check.sh ]; then
+      ( cd ${vlsv_dir} && ./test_check.sh "$run_command_tools $diffbin" ${reference_dir}/${reference_revision} ) >> $GITHUB_WORKSPACE/stdout.txt 2>> $GITHUB_WORKSPACE/stderr.txt || CHECK_ERROR=1
+   fi
+
    # Output CI step annotation
-   if (( $( echo "$MAXERR 0." | awk '{ if($1 > $2) print 1; else print 0 }' ) )); then
+   if [[ $CHECK_ERROR != 0 ]]; then
+      echo -e "<details><summary>:red_circle: ${test_name[$run]}: test_check.sh failed. Speedup: $speedup</summary>\n" >> $GITHUB_STEP_SUMMARY
+      FAILEDTESTS=$((FAILEDTESTS+1))
+      touch $GITHUB_WORKSPACE/testpackage_failed
+   elif (( $( echo "$MAXERR 0." | awk '{ if($1 > $2) print 1; else print 0 }' ) )); then
       echo -e "<details><summary>:large_orange_diamond: ${test_name[$run]}: Nonzero diffs: : \`$MAXERRVAR\` has absolute error $MAXERR, \`$MAXRELVAR\` has relative error $MAXREL. Speedup: $speedup</summary>\n" >> $GITHUB_STEP_SUMMARY
       NONZEROTESTS=$((NONZEROTESTS+1))
    else 
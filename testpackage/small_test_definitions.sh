@@ -18,7 +18,7 @@ run_dir="run"
 test_dir="tests"
 
 # choose tests to run
-run_tests=( 1 2 3 4 5 6 7 8 9 10 11 12 13 14 16 17 18 19 )
+run_tests=( 1 2 3 4 5 6 7 8 9 10 11 12 13 14 16 17 18 19 20 21 )
 
 # acceleration test
 test_name[1]="acctest_2_maxw_500k_100k_20kms_10deg"
@@ -153,3 +153,20 @@ comparison_phiprof[19]="phiprof_0.txt"
 variable_names[19]="proton/vg_rho proton/vg_v proton/vg_v proton/vg_v fg_b fg_b fg_b fg_e fg_e fg_e"
 variable_components[19]="0 0 1 2 0 1 2 0 1 2 0 0"
 single_cell[19]=1
+
+# Mass conservation of acceleration over many gyrations, checked by
+# test_check.sh from the diagnostics
+test_name[20]="acctest_6_mass_conservation"
+comparison_vlsv[20]="fullf.0000001.vlsv"
+comparison_phiprof[20]="phiprof_0.txt"
+variable_names[20]="proton/vg_rho proton/vg_v proton/vg_v proton/vg_v proton"
+variable_components[20]="0 0 1 2"
+single_cell[20]=1
+
+# Translation test with the order of the dimensions alternating between time
+# steps, compared also with the results of test 3 by test_check.sh
+test_name[21]="transtest_3_strang"
+comparison_vlsv[21]="fullf.0000001.vlsv"
+comparison_phiprof[21]="phiprof_0.txt"
+variable_names[21]="proton/vg_rho proton/vg_v proton/vg_v proton/vg_v proton"
+variable_components[21]="0 0 1 2"
@@ -0,0 +1,29 @@
+#!/bin/sh
+
+# Checks that proton/vg_rho plus the accumulated proton/vg_rho_loss_adjust
+# stays at its initial value. With float block data each of the 720 steps can
+# round the mass by at most 2^-24, giving 720 * 6.0e-8 = 4.3e-5 in total.
+tolerance=1.0e-4
+
+gawk -v tolerance=$tolerance '
+/^# Columns/ {
+   if ($6 == "proton/vg_rho") rhoColumn = $3 + 2
+   if ($6 == "proton/vg_rho_loss_adjust") lossColumn = $3 + 2
+   next
+}
+/^#/ { next }
+{
+   mass = $rhoColumn + $lossColumn
+   if (steps == 0) initialMass = mass
+   steps++
+}
+END {
+   if (rhoColumn == 0 || lossColumn == 0 || steps == 0) {
+      print "acctest_6_mass_conservation: no rho or rho_loss_adjust in diagnostic.txt"
+      exit 1
+   }
+   change = (mass - initialMass) / initialMass
+   if (change < 0) change = -change
+   printf "acctest_6_mass_conservation: relative mass change %e over %d steps, tolerance %e\n", change, steps, tolerance
+   if (change > tolerance) exit 1
+}' diagnostic.txt
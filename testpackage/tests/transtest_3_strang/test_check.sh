@@ -0,0 +1,32 @@
+#!/bin/sh
+
+# Compares proton/vg_rho with the reference output of
+# transtest_2_maxw_500k_100k_20kms_20x20, which has the same setup with the
+# fixed x, y, z order.
+#
+# For the uniform flow of the test the x and y mappings commute except
+# through the slope limiters and the sparsity threshold, so the results
+# differ only where the density perturbation is rough. The relative maximum
+# difference must stay below a tenth of the relative perturbation amplitude
+# rhoPertAbsAmp / rho = 1e-2.
+#
+# Usage: test_check.sh <vlsvdiff command> <reference revision directory>
+diffcommand=$1
+reference=$2/transtest_2_maxw_500k_100k_20kms_20x20/fullf.0000001.vlsv
+tolerance=1.0e-3
+
+if [ ! -e $reference ]; then
+   echo "transtest_3_strang: no reference output $reference"
+   exit 1
+fi
+
+$diffcommand $reference fullf.0000001.vlsv proton/vg_rho 0 | gawk -v tolerance=$tolerance '
+/The relative 0-distance between both datasets/ { difference = $8; found = 1 }
+END {
+   if (found == 0) {
+      print "transtest_3_strang: vlsvdiff gave no relative difference for proton/vg_rho"
+      exit 1
+   }
+   printf "transtest_3_strang: relative difference of proton/vg_rho to transtest_2 %e, tolerance %e\n", difference, tolerance
+   if (difference > tolerance) exit 1
+}'
@@ -23,10 +23,12 @@
 #ifndef VELOCITY_BLOCK_CONTAINER_H
 #define VELOCITY_BLOCK_CONTAINER_H
 
+#include <algorithm>
 #include <vector>
 
 #include "common.h"
 #include "unistd.h"
+#include "velocity_block_pool.h"
 
 //#ifdef DEBUG_VBC
 #include <sstream>
@@ -41,6 +43,11 @@ namespace vmesh {
     public:
 
       VelocityBlockContainer();
+      VelocityBlockContainer(const VelocityBlockContainer& other);
+      VelocityBlockContainer(VelocityBlockContainer&& other) noexcept;
+      ~VelocityBlockContainer();
+      VelocityBlockContainer& operator=(const VelocityBlockContainer& other);
+      VelocityBlockContainer& operator=(VelocityBlockContainer&& other) noexcept;
       LID capacity() const;
       size_t capacityInBytes() const;
       void clear();
@@ -72,17 +79,71 @@ namespace vmesh {
 
     private:
       void exitInvalidLocalID(const LID& localID,const std::string& funcName) const;
+      void reallocatePooled(const LID& newCapacity);
+      template<typename T> T* reallocateSlot(BlockPool::Slot& slot,const T* values,const size_t& valuesPerBlock,const LID& newCapacity) const;
       void resize();
       
-      std::vector<Realf,aligned_allocator<Realf,WID3> > block_data;
+      std::vector<Realf,aligned_allocator<Realf,WID3> > block_data;   /**< Block data if the pool is not used.*/
       Realf null_block_data[WID3];
       LID currentCapacity;
       LID numberOfBlocks;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters;
+      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters; /**< Block parameters if the pool is not used.*/
+      Realf* dataPtr;                     /**< Block data, in block_data or in dataSlot.*/
+      Real* parametersPtr;                /**< Block parameters, in parameters or in parameterSlot.*/
+      bool pooled;                        /**< If true, the blocks are stored in slots of BlockPool.*/
+      BlockPool::Slot dataSlot;
+      BlockPool::Slot parameterSlot;
    };
    
    template<typename LID> inline
-   VelocityBlockContainer<LID>::VelocityBlockContainer() : currentCapacity {0}, numberOfBlocks {0} {}
+   VelocityBlockContainer<LID>::VelocityBlockContainer() : currentCapacity {0}, numberOfBlocks {0}, dataPtr {nullptr},
+      parametersPtr {nullptr}, pooled {false} {}
+
+   /** Copy the blocks of another container. The copy uses BlockPool if the
+    * pool is enabled, regardless of the storage of the other container.*/
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::VelocityBlockContainer(const VelocityBlockContainer& other) : VelocityBlockContainer() {
+      *this = other;
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::VelocityBlockContainer(VelocityBlockContainer&& other) noexcept : VelocityBlockContainer() {
+      swap(other);
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::~VelocityBlockContainer() {
+      clear();
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>& VelocityBlockContainer<LID>::operator=(const VelocityBlockContainer& other) {
+      if (this == &other) return *this;
+      clear();
+      std::copy(other.null_block_data,other.null_block_data+WID3,null_block_data);
+      if (other.currentCapacity > 0) {
+         pooled = BlockPool::instance().isEnabled();
+         if (pooled) {
+            reallocatePooled(other.currentCapacity);
+            std::copy(other.dataPtr,other.dataPtr+(size_t)other.numberOfBlocks*WID3,dataPtr);
+            std::copy(other.parametersPtr,other.parametersPtr+(size_t)other.numberOfBlocks*BlockParams::N_VELOCITY_BLOCK_PARAMS,parametersPtr);
+         } else {
+            block_data.assign(other.dataPtr,other.dataPtr+(size_t)other.currentCapacity*WID3);
+            parameters.assign(other.parametersPtr,other.parametersPtr+(size_t)other.currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+            dataPtr = block_data.data();
+            parametersPtr = parameters.data();
+         }
+      }
+      currentCapacity = other.currentCapacity;
+      numberOfBlocks = other.numberOfBlocks;
+      return *this;
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>& VelocityBlockContainer<LID>::operator=(VelocityBlockContainer&& other) noexcept {
+      swap(other);
+      return *this;
+   }
    
    template<typename LID> inline
    LID VelocityBlockContainer<LID>::capacity() const {
@@ -91,6 +152,7 @@ namespace vmesh {
    
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::capacityInBytes() const {
+      if (pooled) return (size_t)currentCapacity*(WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real));
       return (block_data.capacity())*sizeof(Realf) + parameters.capacity()*sizeof(Real);
    }
 
@@ -98,12 +160,19 @@ namespace vmesh {
     * reserved for velocity blocks.*/
    template<typename LID> inline
    void VelocityBlockContainer<LID>::clear() {
+      if (pooled) {
+         BlockPool::instance().release(dataSlot,(size_t)currentCapacity*WID3*sizeof(Realf));
+         BlockPool::instance().release(parameterSlot,(size_t)currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real));
+         pooled = false;
+      }
       std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data;
       std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > dummy_parameters;
       
       block_data.swap(dummy_data);
       parameters.swap(dummy_parameters);
       
+      dataPtr = nullptr;
+      parametersPtr = nullptr;
       currentCapacity = 0;
       numberOfBlocks = 0;
    }
@@ -118,23 +187,21 @@ namespace vmesh {
          if (target >= currentCapacity) ok = false;
          if (numberOfBlocks >= currentCapacity) ok = false;
          if (source != numberOfBlocks-1) ok = false;
-         if (source*WID3+WID3-1 >= block_data.size()) ok = false;
-         if (source*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (target*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS != block_data.size()/WID3) ok = false;
+         if (!pooled && block_data.size() != (size_t)currentCapacity*WID3) ok = false;
+         if (!pooled && parameters.size() != (size_t)currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS) ok = false;
          if (ok == false) {
             std::stringstream ss;
             ss << "VBC ERROR: invalid source LID=" << source << " in copy, target=" << target << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
-            ss << "or sizes are wrong, data.size()=" << block_data.size() << " parameters.size()=" << parameters.size() << std::endl;
+            ss << "or sizes are wrong, data.size()=" << block_data.size() << " parameters.size()=" << parameters.size() << " pooled=" << pooled << std::endl;
             std::cerr << ss.str();
             sleep(1);
             exit(1);
          }
       #endif
 
-      for (unsigned int i=0; i<WID3; ++i) block_data[target*WID3+i] = block_data[source*WID3+i];
+      for (unsigned int i=0; i<WID3; ++i) dataPtr[target*WID3+i] = dataPtr[source*WID3+i];
       for (int i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) {
-         parameters[target*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = parameters[source*BlockParams::N_VELOCITY_BLOCK_PARAMS+i];
+         parametersPtr[target*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = parametersPtr[source*BlockParams::N_VELOCITY_BLOCK_PARAMS+i];
       }
    }
 
@@ -158,30 +225,30 @@ namespace vmesh {
    
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData() {
-      return block_data.data();
+      return dataPtr;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData() const {
-      return block_data.data();
+      return dataPtr;
    }
 
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getData");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      return dataPtr + blockLID*WID3;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getData const");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      return dataPtr + blockLID*WID3;
    }
 
    template<typename LID> inline
@@ -191,30 +258,30 @@ namespace vmesh {
 
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters() {
-      return parameters.data();
+      return parametersPtr;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters() const {
-      return parameters.data();
+      return parametersPtr;
    }
 
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getParameters");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      return parametersPtr + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getParameters const");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      return parametersPtr + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
    }
    
    template<typename LID> inline
@@ -229,10 +296,10 @@ namespace vmesh {
       if (newIndex >= currentCapacity) resize();
 
       #ifdef DEBUG_VBC
-      if (newIndex >= block_data.size()/WID3 || newIndex >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) {
+      if (newIndex >= currentCapacity) {
          std::stringstream ss;
          ss << "VBC ERROR in push_back, LID=" << newIndex << " for new block is out of bounds" << std::endl;
-         ss << "\t data.size()=" << block_data.size()  << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "\t capacity=" << currentCapacity << " pooled=" << pooled << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -240,9 +307,9 @@ namespace vmesh {
       #endif
 
       // Clear velocity block data to zero values
-      for (size_t i=0; i<WID3; ++i) block_data[newIndex*WID3+i] = 0.0;
+      for (size_t i=0; i<WID3; ++i) dataPtr[newIndex*WID3+i] = 0.0;
       for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) 
-         parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+         parametersPtr[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
 
       ++numberOfBlocks;
       return newIndex;
@@ -255,9 +322,9 @@ namespace vmesh {
       resize();
       
       // Clear velocity block data to zero values
-      for (size_t i=0; i<WID3*N_blocks; ++i) block_data[newIndex*WID3+i] = 0.0;
+      for (size_t i=0; i<WID3*N_blocks; ++i) dataPtr[newIndex*WID3+i] = 0.0;
       for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS*N_blocks; ++i)
-	parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+	parametersPtr[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
 
       return newIndex;
    }
@@ -265,6 +332,13 @@ namespace vmesh {
    template<typename LID> inline
    bool VelocityBlockContainer<LID>::recapacitate(const LID& newCapacity) {
       if (newCapacity < numberOfBlocks) return false;
+      if (currentCapacity == 0 && dataSlot.ptr == nullptr) pooled = BlockPool::instance().isEnabled();
+      if (pooled) {
+         // Pages after the new capacity are returned, the blocks stay in place
+         reallocatePooled(newCapacity);
+         currentCapacity = newCapacity;
+         return true;
+      }
       {
          std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data(newCapacity*WID3);
          for (size_t i=0; i<numberOfBlocks*WID3; ++i) dummy_data[i] = block_data[i];
@@ -275,19 +349,58 @@ namespace vmesh {
          for (size_t i=0; i<numberOfBlocks*BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) dummy_parameters[i] = parameters[i];
          dummy_parameters.swap(parameters);
       }
+      dataPtr = block_data.data();
+      parametersPtr = parameters.data();
       currentCapacity = newCapacity;
       return true;
    }
 
+   /** Fit the pooled storage to newCapacity blocks. The blocks stay in their
+    * slots if the slots are large enough, the pages after the new capacity
+    * are returned to the system. Otherwise the first
+    * min(currentCapacity,newCapacity) blocks are copied to larger slots.*/
+   template<typename LID> inline
+   void VelocityBlockContainer<LID>::reallocatePooled(const LID& newCapacity) {
+      dataPtr = reallocateSlot(dataSlot,dataPtr,WID3,newCapacity);
+      parametersPtr = reallocateSlot(parameterSlot,parametersPtr,BlockParams::N_VELOCITY_BLOCK_PARAMS,newCapacity);
+   }
+
+   template<typename LID> template<typename T> inline
+   T* VelocityBlockContainer<LID>::reallocateSlot(BlockPool::Slot& slot,const T* values,const size_t& valuesPerBlock,const LID& newCapacity) const {
+      BlockPool& pool = BlockPool::instance();
+      const size_t usedBytes = currentCapacity*valuesPerBlock*sizeof(T);
+      const size_t newBytes = newCapacity*valuesPerBlock*sizeof(T);
+      if (slot.ptr != nullptr && newBytes <= BlockPool::slotBytes(slot)) {
+         pool.decommit(slot,newBytes,usedBytes);
+      } else {
+         BlockPool::Slot newSlot = pool.allocate(newBytes);
+         if (values != nullptr) {
+            std::copy(values,values+std::min(currentCapacity,newCapacity)*valuesPerBlock,reinterpret_cast<T*>(newSlot.ptr));
+         }
+         pool.release(slot,usedBytes);
+         slot = newSlot;
+      }
+      return reinterpret_cast<T*>(slot.ptr);
+   }
+
    template<typename LID> inline
    void VelocityBlockContainer<LID>::resize() {
       if ((numberOfBlocks+1) >= currentCapacity) {
          // Resize so that free space is block_allocation_chunk blocks, 
          // and at least two in case of having zero blocks.
          // The order of velocity blocks is unaltered.
-         currentCapacity = 2 + numberOfBlocks * BLOCK_ALLOCATION_FACTOR;
-         block_data.resize(currentCapacity*WID3);
-         parameters.resize(currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+         // With the pool the blocks only move when they outgrow their slots.
+         const LID newCapacity = 2 + numberOfBlocks * BLOCK_ALLOCATION_FACTOR;
+         if (currentCapacity == 0 && dataSlot.ptr == nullptr) pooled = BlockPool::instance().isEnabled();
+         if (pooled) {
+            reallocatePooled(newCapacity);
+         } else {
+            block_data.resize(newCapacity*WID3);
+            parameters.resize(newCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+            dataPtr = block_data.data();
+            parametersPtr = parameters.data();
+         }
+         currentCapacity = newCapacity;
       }
    }
 
@@ -307,13 +420,18 @@ namespace vmesh {
 
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::sizeInBytes() const {
-      return block_data.size()*sizeof(Realf) + parameters.size()*sizeof(Real);
+      return (size_t)currentCapacity*(WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real));
    }
 
    template<typename LID> inline
    void VelocityBlockContainer<LID>::swap(VelocityBlockContainer& vbc) {
       block_data.swap(vbc.block_data);
       parameters.swap(vbc.parameters);
+      std::swap(dataPtr,vbc.dataPtr);
+      std::swap(parametersPtr,vbc.parametersPtr);
+      std::swap(pooled,vbc.pooled);
+      std::swap(dataSlot,vbc.dataSlot);
+      std::swap(parameterSlot,vbc.parameterSlot);
 
       LID dummy = currentCapacity;
       currentCapacity = vbc.currentCapacity;
@@ -331,16 +449,16 @@ namespace vmesh {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
       }
 
-      return block_data[blockLID*WID3+cell];
+      return dataPtr[blockLID*WID3+cell];
    }
 
    template<typename LID> inline
@@ -348,16 +466,16 @@ namespace vmesh {
       bool ok = true;
       if (cell >= BlockParams::N_VELOCITY_BLOCK_PARAMS) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell >= parameters.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
       }
       
-      return parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell];
+      return parametersPtr[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell];
    }
    
    template<typename LID> inline
@@ -365,16 +483,16 @@ namespace vmesh {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
       }
       
-      block_data[blockLID*WID3+cell] = value;
+      dataPtr[blockLID*WID3+cell] = value;
    }
    
    #endif
@@ -0,0 +1,183 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef VELOCITY_BLOCK_POOL_H
+#define VELOCITY_BLOCK_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace vmesh {
+
+   /** Rank-wide pool of address space for the velocity block arrays of
+    * VelocityBlockContainer, enabled with vlasovsolver.blockPool.
+    *
+    * The pool hands out slots of reserved virtual memory in size classes of
+    * minSlotBytes*4^c. Physical pages of a slot are committed by the kernel
+    * when they are first written and returned with madvise(MADV_DONTNEED)
+    * when the container shrinks or releases the slot, so a container grows
+    * in place up to the size of its slot without copying its blocks, and
+    * the memory of a rank stays within a page per array of the live
+    * capacity of its containers. Slots are carved from a few large
+    * mappings, released slots are kept in per-class free lists.
+    */
+   class BlockPool {
+    public:
+      struct Slot {
+         char* ptr {nullptr};       /**< Start of the slot, nullptr if no slot is held.*/
+         int sizeClass {-1};        /**< Size class of the slot.*/
+      };
+
+      static BlockPool& instance();
+
+      Slot allocate(const size_t& bytes);
+      void decommit(const Slot& slot,const size_t& keepBytes,const size_t& usedBytes);
+      bool isEnabled() const;
+      void release(Slot& slot,const size_t& usedBytes);
+      void setEnabled(const bool& enabled);
+      size_t slotsInUse() const;
+
+      static size_t slotBytes(const Slot& slot);
+
+    private:
+      BlockPool() {}
+      BlockPool(const BlockPool&) = delete;
+      BlockPool& operator=(const BlockPool&) = delete;
+
+      static size_t pageRoundUp(const size_t& bytes);
+
+      static constexpr size_t minSlotBytes = 65536;           /**< Size of the slots of class 0.*/
+      static constexpr size_t chunkBytes = size_t(1) << 30;   /**< Minimum size of the mappings slots are carved from.*/
+      static constexpr int N_SIZE_CLASSES = 12;
+
+      struct SizeClass {
+         char* next {nullptr};      /**< First uncarved slot of the current mapping.*/
+         char* end {nullptr};       /**< End of the current mapping.*/
+         std::vector<char*> free;   /**< Released slots.*/
+      };
+
+      bool enabled {false};
+      size_t nSlotsInUse {0};
+      SizeClass sizeClasses[N_SIZE_CLASSES];
+      mutable std::mutex mutex;
+   };
+
+   inline BlockPool& BlockPool::instance() {
+      static BlockPool pool;
+      return pool;
+   }
+
+   /** Get a slot of at least the given size from the pool. The contents of
+    * the slot are zero or left over from its previous user.
+    * @param bytes Minimum size of the slot.
+    * @return The slot.*/
+   inline BlockPool::Slot BlockPool::allocate(const size_t& bytes) {
+      Slot slot;
+      slot.sizeClass = 0;
+      while (slot.sizeClass < N_SIZE_CLASSES && slotBytes(slot) < bytes) ++slot.sizeClass;
+      if (slot.sizeClass == N_SIZE_CLASSES) {
+         std::cerr << "BlockPool ERROR: no size class for " << bytes << " bytes" << std::endl;
+         sleep(1);
+         exit(1);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      SizeClass& sizeClass = sizeClasses[slot.sizeClass];
+      if (sizeClass.free.size() > 0) {
+         slot.ptr = sizeClass.free.back();
+         sizeClass.free.pop_back();
+      } else {
+         if (sizeClass.next == sizeClass.end) {
+            const size_t mappingBytes = std::max(chunkBytes,slotBytes(slot));
+            void* mapping = mmap(nullptr,mappingBytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+            if (mapping == MAP_FAILED) {
+               std::cerr << "BlockPool ERROR: failed to map " << mappingBytes << " bytes for size class " << slot.sizeClass << std::endl;
+               sleep(1);
+               exit(1);
+            }
+            sizeClass.next = static_cast<char*>(mapping);
+            sizeClass.end = sizeClass.next + mappingBytes;
+         }
+         slot.ptr = sizeClass.next;
+         sizeClass.next += slotBytes(slot);
+      }
+      ++nSlotsInUse;
+      return slot;
+   }
+
+   /** Return the pages of a slot after its first keepBytes bytes to the system.
+    * @param slot The slot.
+    * @param keepBytes Number of bytes at the start of the slot that are kept.
+    * @param usedBytes Number of bytes at the start of the slot that may have been written to.*/
+   inline void BlockPool::decommit(const Slot& slot,const size_t& keepBytes,const size_t& usedBytes) {
+      if (slot.ptr == nullptr) return;
+      const size_t begin = pageRoundUp(keepBytes);
+      const size_t end = std::min(pageRoundUp(usedBytes),slotBytes(slot));
+      if (begin >= end) return;
+      madvise(slot.ptr + begin,end - begin,MADV_DONTNEED);
+   }
+
+   inline bool BlockPool::isEnabled() const {
+      return enabled;
+   }
+
+   /** Return a slot and its pages to the pool.
+    * @param slot The slot, reset to an empty slot.
+    * @param usedBytes Number of bytes at the start of the slot that may have been written to.*/
+   inline void BlockPool::release(Slot& slot,const size_t& usedBytes) {
+      if (slot.ptr == nullptr) return;
+      decommit(slot,0,usedBytes);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      sizeClasses[slot.sizeClass].free.push_back(slot.ptr);
+      --nSlotsInUse;
+      slot = Slot();
+   }
+
+   /** Enable the pool for containers that allocate their first blocks after
+    * this call, containers that already hold blocks keep their storage.*/
+   inline void BlockPool::setEnabled(const bool& enabled) {
+      this->enabled = enabled;
+   }
+
+   inline size_t BlockPool::slotsInUse() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return nSlotsInUse;
+   }
+
+   inline size_t BlockPool::slotBytes(const Slot& slot) {
+      return minSlotBytes << (2*slot.sizeClass);
+   }
+
+   inline size_t BlockPool::pageRoundUp(const size_t& bytes) {
+      static const size_t pageBytes = sysconf(_SC_PAGESIZE);
+      return (bytes + pageBytes - 1) / pageBytes * pageBytes;
+   }
+
+} // namespace vmesh
+
+#endif
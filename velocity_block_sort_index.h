@@ -0,0 +1,287 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef VELOCITY_BLOCK_SORT_INDEX_H
+#define VELOCITY_BLOCK_SORT_INDEX_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#ifdef DEBUG_ACC
+   #include <cstdlib>
+   #include <iostream>
+#endif
+
+#ifndef VAMR
+   #include "velocity_mesh_old.h"
+#else
+   #include "velocity_mesh_amr.h"
+#endif
+
+namespace vmesh {
+
+   /** Persistent list of the blocks of a velocity mesh sorted along each of
+    * the three velocity dimensions, as needed for building the block columns
+    * in the semi-Lagrangian acceleration.
+    *
+    * The velocity mesh changes only little between two acceleration sweeps,
+    * so instead of sorting all blocks again the previous sorted lists are
+    * patched with the blocks that were added or removed since. The owner of
+    * the velocity mesh reports these changes with added() and removed(), and
+    * calls invalidate() whenever the mesh is replaced as a whole. Each sorted
+    * list is brought up to date lazily in getSorted().*/
+   template<typename GID,typename LID>
+   class VelocityBlockSortIndex {
+    public:
+
+      VelocityBlockSortIndex();
+      void added(const GID& blockGID);
+      size_t capacityInBytes() const;
+      void clear();
+      const std::vector<std::pair<GID,GID> >& getSorted(const VelocityMesh<GID,LID>& vmesh,const int& dimension);
+      void invalidate();
+      void removed(const GID& blockGID);
+      static GID sortKey(const VelocityMesh<GID,LID>& vmesh,const int& dimension,const GID& blockGID);
+
+    private:
+      #ifdef DEBUG_ACC
+      void checkConsistency(const VelocityMesh<GID,LID>& vmesh,const int& dimension) const;
+      #endif
+      void logChange(const GID& blockGID);
+      void rebuild(const VelocityMesh<GID,LID>& vmesh,const int& dimension);
+      void trimLog();
+      void update(const VelocityMesh<GID,LID>& vmesh,const int& dimension);
+
+      std::vector<std::pair<GID,GID> > sorted[3];  /**< (sort key, global ID) pairs of all blocks, sorted by the key.*/
+      bool valid[3];                               /**< If false the sorted list must be rebuilt from scratch.*/
+      size_t logPosition[3];                       /**< Position in changeLog up to which the sorted list is patched.*/
+      std::vector<GID> changeLog;                  /**< Global IDs of the blocks added or removed since the
+                                                    * oldest sorted list was updated.*/
+      std::vector<GID> changed;                    /**< Scratch space used when patching.*/
+      std::vector<std::pair<GID,GID> > merged;     /**< Scratch space used when patching.*/
+   };
+
+   template<typename GID,typename LID> inline
+   VelocityBlockSortIndex<GID,LID>::VelocityBlockSortIndex() {
+      invalidate();
+   }
+
+   /** Record that the given block was added to the velocity mesh.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::added(const GID& blockGID) {
+      logChange(blockGID);
+   }
+
+   template<typename GID,typename LID> inline
+   size_t VelocityBlockSortIndex<GID,LID>::capacityInBytes() const {
+      size_t capacity = (changeLog.capacity() + changed.capacity())*sizeof(GID);
+      capacity += merged.capacity()*sizeof(std::pair<GID,GID>);
+      for (int d=0; d<3; ++d) capacity += sorted[d].capacity()*sizeof(std::pair<GID,GID>);
+      return capacity;
+   }
+
+   #ifdef DEBUG_ACC
+   /** Check that the sorted list of the given dimension holds exactly the
+    * blocks of the velocity mesh, with correct keys in increasing order.
+    * A change to the mesh that was not reported, e.g. a removed block
+    * replaced by another one, leaves the size unchanged but is found here.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::checkConsistency(const VelocityMesh<GID,LID>& vmesh,const int& dimension) const {
+      const std::vector<std::pair<GID,GID> >& list = sorted[dimension];
+      bool ok = (list.size() == vmesh.size());
+      for (size_t i=0; ok && i<list.size(); ++i) {
+         if (vmesh.getLocalID(list[i].second) == VelocityMesh<GID,LID>::invalidLocalID()) ok = false;
+         if (list[i].first != sortKey(vmesh,dimension,list[i].second)) ok = false;
+         if (i > 0 && list[i-1].first >= list[i].first) ok = false;
+      }
+      if (ok == false) {
+         std::cerr << "ERROR in VelocityBlockSortIndex: sorted list of dimension " << dimension << " with "
+                   << list.size() << " blocks does not match the velocity mesh with " << vmesh.size()
+                   << " blocks, a change to the mesh was not reported" << std::endl;
+         exit(1);
+      }
+   }
+   #endif
+
+   /** Invalidate the index and deallocate its memory.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::clear() {
+      for (int d=0; d<3; ++d) std::vector<std::pair<GID,GID> >().swap(sorted[d]);
+      std::vector<GID>().swap(changeLog);
+      std::vector<GID>().swap(changed);
+      std::vector<std::pair<GID,GID> >().swap(merged);
+      invalidate();
+   }
+
+   /** Get the (sort key, global ID) pairs of all blocks in the given
+    * velocity mesh, sorted along the given dimension.
+    * @param vmesh Velocity mesh, must be the mesh whose changes have been reported to this index.
+    * @param dimension Velocity dimension, 0, 1 or 2.
+    * @return Sorted pairs, valid until the next call with the same dimension.*/
+   template<typename GID,typename LID> inline
+   const std::vector<std::pair<GID,GID> >& VelocityBlockSortIndex<GID,LID>::getSorted(const VelocityMesh<GID,LID>& vmesh,
+                                                                                      const int& dimension) {
+      update(vmesh,dimension);
+      #ifdef DEBUG_ACC
+      checkConsistency(vmesh,dimension);
+      #endif
+      return sorted[dimension];
+   }
+
+   /** Invalidate all sorted lists, they are rebuilt at the next call to getSorted().
+    * Called when the velocity mesh is replaced as a whole.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::invalidate() {
+      for (int d=0; d<3; ++d) {
+         valid[d] = false;
+         logPosition[d] = 0;
+      }
+      changeLog.clear();
+   }
+
+   /** Append the given block to the change log. If the log grows longer
+    * than the sorted lists, e.g., because the index is not queried at all,
+    * the lists are invalidated instead since rebuilding them is cheaper.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::logChange(const GID& blockGID) {
+      if (valid[0] == false && valid[1] == false && valid[2] == false) return;
+      size_t maxSize = 0;
+      for (int d=0; d<3; ++d) maxSize = std::max(maxSize,sorted[d].size());
+      if (changeLog.size() >= maxSize) {
+         invalidate();
+         return;
+      }
+      changeLog.push_back(blockGID);
+   }
+
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::rebuild(const VelocityMesh<GID,LID>& vmesh,const int& dimension) {
+      std::vector<std::pair<GID,GID> >& list = sorted[dimension];
+      list.resize(vmesh.size());
+      for (LID i=0; i<vmesh.size(); ++i) {
+         const GID blockGID = vmesh.getGlobalID(i);
+         list[i] = std::make_pair(sortKey(vmesh,dimension,blockGID),blockGID);
+      }
+      std::sort(list.begin(),list.end());
+      valid[dimension] = true;
+      logPosition[dimension] = changeLog.size();
+   }
+
+   /** Record that the given block was removed from the velocity mesh.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::removed(const GID& blockGID) {
+      logChange(blockGID);
+   }
+
+   /** Get the key used to sort the given block along the given dimension.
+    * The key is the block index with the given dimension running fastest,
+    * so that blocks in the same column are consecutive when sorted:
+    *   dimension 0: x + y*x_max + z*y_max*x_max (the global ID)
+    *   dimension 1: y + x*y_max + z*y_max*x_max
+    *   dimension 2: z + y*z_max + x*z_max*y_max
+    * The key is unique, and the index of the block along the dimension is
+    * key % grid_length[dimension].*/
+   template<typename GID,typename LID> inline
+   GID VelocityBlockSortIndex<GID,LID>::sortKey(const VelocityMesh<GID,LID>& vmesh,const int& dimension,const GID& blockGID) {
+      // Velocity mesh refinement level, has no effect here
+      // but is needed in some vmesh::VelocityMesh function calls.
+      const uint8_t REFLEVEL = 0;
+      const LID* gridLength = vmesh.getGridLength(REFLEVEL);
+
+      const GID x_index = blockGID % gridLength[0];
+      const GID y_index = (blockGID / gridLength[0]) % gridLength[1];
+      switch (dimension) {
+       case 0:
+         return blockGID;
+       case 1:
+         return blockGID - (x_index + y_index*gridLength[0]) + y_index + x_index*gridLength[1];
+       default: {
+          const GID z_index = blockGID / (gridLength[0]*gridLength[1]);
+          return z_index + y_index*gridLength[2] + x_index*gridLength[1]*gridLength[2];
+       }
+      }
+   }
+
+   /** Drop the part of the change log that all valid sorted lists have already consumed.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::trimLog() {
+      size_t consumed = changeLog.size();
+      for (int d=0; d<3; ++d) {
+         if (valid[d]) consumed = std::min(consumed,logPosition[d]);
+      }
+      if (consumed == 0) return;
+      changeLog.erase(changeLog.begin(),changeLog.begin() + consumed);
+      for (int d=0; d<3; ++d) {
+         logPosition[d] = (logPosition[d] > consumed) ? logPosition[d] - consumed : 0;
+      }
+   }
+
+   /** Bring the sorted list of the given dimension up to date with the velocity mesh.*/
+   template<typename GID,typename LID> inline
+   void VelocityBlockSortIndex<GID,LID>::update(const VelocityMesh<GID,LID>& vmesh,const int& dimension) {
+      // Rebuilding is cheaper than patching if most of the mesh has changed
+      if (valid[dimension] == false || changeLog.size() - logPosition[dimension] > vmesh.size()) {
+         rebuild(vmesh,dimension);
+         trimLog();
+         return;
+      }
+      if (logPosition[dimension] == changeLog.size()) {
+         return;
+      }
+
+      // Blocks that were added or removed since the last update, a block may
+      // have been added and removed several times so only its current state counts
+      changed.assign(changeLog.begin() + logPosition[dimension],changeLog.end());
+      std::sort(changed.begin(),changed.end());
+      changed.erase(std::unique(changed.begin(),changed.end()),changed.end());
+
+      // Drop the changed blocks from the old list, and add the ones that
+      // currently exist in the mesh in sorted order after the old entries
+      std::vector<std::pair<GID,GID> >& list = sorted[dimension];
+      size_t n = 0;
+      for (size_t i=0; i<list.size(); ++i) {
+         if (std::binary_search(changed.begin(),changed.end(),list[i].second)) continue;
+         list[n++] = list[i];
+      }
+      const size_t nKept = n;
+      list.resize(nKept);
+      for (size_t i=0; i<changed.size(); ++i) {
+         if (vmesh.getLocalID(changed[i]) == VelocityMesh<GID,LID>::invalidLocalID()) continue;
+         list.push_back(std::make_pair(sortKey(vmesh,dimension,changed[i]),changed[i]));
+      }
+      std::sort(list.begin() + nKept,list.end());
+
+      merged.resize(list.size());
+      std::merge(list.begin(),list.begin() + nKept,list.begin() + nKept,list.end(),merged.begin());
+      list.swap(merged);
+      logPosition[dimension] = changeLog.size();
+
+      // The mesh has been modified without reporting the change. This only
+      // catches changes of the size, checkConsistency checks the blocks.
+      if (list.size() != vmesh.size()) rebuild(vmesh,dimension);
+
+      trimLog();
+   }
+
+} // namespace vmesh
+
+#endif
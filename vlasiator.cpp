@@ -378,6 +378,9 @@ int main(int argn,char* args[]) {
    project->getParameters();
    readParamsTimer.stop();
 
+   // Containers allocate their blocks from the pool from now on
+   vmesh::BlockPool::instance().setEnabled(P::vlasovBlockPool);
+
    //Get version and config info here
    std::string version;
    std::string config;
@@ -1288,6 +1291,12 @@ int main(int argn,char* args[]) {
       }
       vspaceTimer.stop(computedCells, "Cells");
       addTimedBarrier("barrier-after-acceleration");
+
+      // Weights measured in translation and acceleration are in ns, the
+      // rebalance on the next step expects them in blocks
+      if (P::prepareForRebalance == true) {
+         normalizeLoadBalanceWeights(mpiGrid);
+      }
       
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration ) {
          phiprof::Timer timer {"Update system boundaries (Vlasov post-acceleration)"};
@@ -67,7 +67,7 @@ for dimension in range(0, 2):
     cog.outl("      Realf* __restrict__ data = blockContainer.getData(vmesh.getLocalID(blocks[block_k]));")    
     for vecl in [4, 8, 16]:
         for accuracy in ["f", "d"]:
-            cog.outl("#ifdef VEC%d%s_AGNER" % (vecl, accuracy.upper()))
+            cog.outl("#if defined(VEC%d%s_AGNER) && !defined(VEC_MIXED_PRECISION)" % (vecl, accuracy.upper()))
             cell = 0
             for k in range(0, WID):
                 for planeVector in range(0, WID2/vecl):
@@ -109,7 +109,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(2, 3, block_k, n_blocks)] = gather4f<11 ,27 ,43 ,59>(data);
          values[i_pcolumnv_b(3, 3, block_k, n_blocks)] = gather4f<15 ,31 ,47 ,63>(data);
    #endif //VEC4F_AGNER
-   #ifdef VEC4D_AGNER
+   #if defined(VEC4D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather4d<0 ,16 ,32 ,48>(data);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = gather4d<4 ,20 ,36 ,52>(data);
          values[i_pcolumnv_b(2, 0, block_k, n_blocks)] = gather4d<8 ,24 ,40 ,56>(data);
@@ -128,7 +128,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(3, 3, block_k, n_blocks)] = gather4d<15 ,31 ,47 ,63>(data);
    #endif //VEC4D_AGNER
 
-#if defined(VEC4F_FALLBACK) || defined(VEC4D_FALLBACK)
+#if defined(VEC4F_FALLBACK) || defined(VEC4D_FALLBACK) || defined(VEC4F_STDSIMD) || defined(VEC4D_STDSIMD) || (defined(VEC4D_AGNER) && defined(VEC_MIXED_PRECISION))
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[16], data[32], data[48]);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = Vec(data[4], data[20], data[36], data[52]);
          values[i_pcolumnv_b(2, 0, block_k, n_blocks)] = Vec(data[8], data[24], data[40], data[56]);
@@ -145,7 +145,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = Vec(data[7], data[23], data[39], data[55]);
          values[i_pcolumnv_b(2, 3, block_k, n_blocks)] = Vec(data[11], data[27], data[43], data[59]);
          values[i_pcolumnv_b(3, 3, block_k, n_blocks)] = Vec(data[15], data[31], data[47], data[63]);
-#endif //VEC4F_FALLBACK || VEC4D_FALLBACK
+#endif //VEC4F_FALLBACK || VEC4D_FALLBACK || VEC4F/VEC4D_STDSIMD || mixed precision VEC4D_AGNER
 
    #ifdef VEC8F_AGNER
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather8f<0 ,16 ,32 ,48 ,4 ,20 ,36 ,52>(data);
@@ -157,7 +157,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather8f<3 ,19 ,35 ,51 ,7 ,23 ,39 ,55>(data);
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = gather8f<11 ,27 ,43 ,59 ,15 ,31 ,47 ,63>(data);
    #endif //VEC8F_AGNER
-   #ifdef VEC8D_AGNER
+   #if defined(VEC8D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather8d<0 ,16 ,32 ,48 ,4 ,20 ,36 ,52>(data);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = gather8d<8 ,24 ,40 ,56 ,12 ,28 ,44 ,60>(data);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = gather8d<1 ,17 ,33 ,49 ,5 ,21 ,37 ,53>(data);
@@ -168,7 +168,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = gather8d<11 ,27 ,43 ,59 ,15 ,31 ,47 ,63>(data);
    #endif //VEC8D_AGNER
 
-#if defined(VEC8F_FALLBACK) || defined(VEC8D_FALLBACK)
+#if defined(VEC8F_FALLBACK) || defined(VEC8D_FALLBACK) || defined(VEC8F_STDSIMD) || defined(VEC8D_STDSIMD) || (defined(VEC8D_AGNER) && defined(VEC_MIXED_PRECISION))
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[16], data[32], data[48], data[4], data[20], data[36], data[52]);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = Vec(data[8], data[24], data[40], data[56], data[12], data[28], data[44], data[60]);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = Vec(data[1], data[17], data[33], data[49], data[5], data[21], data[37], data[53]);
@@ -177,7 +177,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 2, block_k, n_blocks)] = Vec(data[10], data[26], data[42], data[58], data[14], data[30], data[46], data[62]);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = Vec(data[3], data[19], data[35], data[51], data[7], data[23], data[39], data[55]);
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = Vec(data[11], data[27], data[43], data[59], data[15], data[31], data[47], data[63]);
-#endif //VEC8F_FALLBACK || VEC8D_FALLBACK
+#endif //VEC8F_FALLBACK || VEC8D_FALLBACK || VEC8F/VEC8D_STDSIMD || mixed precision VEC8D_AGNER
 
    #ifdef VEC16F_AGNER
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather16f<0 ,16 ,32 ,48 ,4 ,20 ,36 ,52 ,8 ,24 ,40 ,56 ,12 ,28 ,44 ,60>(data);
@@ -185,12 +185,18 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = gather16f<2 ,18 ,34 ,50 ,6 ,22 ,38 ,54 ,10 ,26 ,42 ,58 ,14 ,30 ,46 ,62>(data);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather16f<3 ,19 ,35 ,51 ,7 ,23 ,39 ,55 ,11 ,27 ,43 ,59 ,15 ,31 ,47 ,63>(data);
    #endif //VEC16F_AGNER
-   #ifdef VEC16D_AGNER
+   #if defined(VEC16D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather16d<0 ,16 ,32 ,48 ,4 ,20 ,36 ,52 ,8 ,24 ,40 ,56 ,12 ,28 ,44 ,60>(data);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = gather16d<1 ,17 ,33 ,49 ,5 ,21 ,37 ,53 ,9 ,25 ,41 ,57 ,13 ,29 ,45 ,61>(data);
          values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = gather16d<2 ,18 ,34 ,50 ,6 ,22 ,38 ,54 ,10 ,26 ,42 ,58 ,14 ,30 ,46 ,62>(data);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather16d<3 ,19 ,35 ,51 ,7 ,23 ,39 ,55 ,11 ,27 ,43 ,59 ,15 ,31 ,47 ,63>(data);
    #endif //VEC16D_AGNER
+#if defined(VEC16F_FALLBACK) || defined(VEC16F_STDSIMD)
+         values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[16], data[32], data[48], data[4], data[20], data[36], data[52], data[8], data[24], data[40], data[56], data[12], data[28], data[44], data[60]);
+         values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = Vec(data[1], data[17], data[33], data[49], data[5], data[21], data[37], data[53], data[9], data[25], data[41], data[57], data[13], data[29], data[45], data[61]);
+         values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = Vec(data[2], data[18], data[34], data[50], data[6], data[22], data[38], data[54], data[10], data[26], data[42], data[58], data[14], data[30], data[46], data[62]);
+         values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = Vec(data[3], data[19], data[35], data[51], data[7], data[23], data[39], data[55], data[11], data[27], data[43], data[59], data[15], data[31], data[47], data[63]);
+#endif //VEC16F_FALLBACK || VEC16F_STDSIMD
          //zero old output data
          for (uint i=0; i<WID3; ++i) {
             data[i]=0;
@@ -219,7 +225,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(3, 3, block_k, n_blocks)] = gather4f<60 ,61 ,62 ,63>(data);
    #endif //VEC4F_AGNER
 
-#if defined(VEC4F_FALLBACK) || defined(VEC4D_FALLBACK)
+#if defined(VEC4F_FALLBACK) || defined(VEC4D_FALLBACK) || defined(VEC4F_STDSIMD) || defined(VEC4D_STDSIMD) || (defined(VEC4D_AGNER) && defined(VEC_MIXED_PRECISION))
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[1], data[2], data[3]);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = Vec(data[16], data[17], data[18], data[19]);
          values[i_pcolumnv_b(2, 0, block_k, n_blocks)] = Vec(data[32], data[33], data[34], data[35]);
@@ -236,9 +242,9 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = Vec(data[28], data[29], data[30], data[31]);
          values[i_pcolumnv_b(2, 3, block_k, n_blocks)] = Vec(data[44], data[45], data[46], data[47]);
          values[i_pcolumnv_b(3, 3, block_k, n_blocks)] = Vec(data[60], data[61], data[62], data[63]);
-#endif //VEC4F_FALLBACK || VEC4D_FALLBACK
+#endif //VEC4F_FALLBACK || VEC4D_FALLBACK || VEC4F/VEC4D_STDSIMD || mixed precision VEC4D_AGNER
 
-   #ifdef VEC4D_AGNER
+   #if defined(VEC4D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather4d<0 ,1 ,2 ,3>(data);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = gather4d<16 ,17 ,18 ,19>(data);
          values[i_pcolumnv_b(2, 0, block_k, n_blocks)] = gather4d<32 ,33 ,34 ,35>(data);
@@ -266,7 +272,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather8f<12 ,13 ,14 ,15 ,28 ,29 ,30 ,31>(data);
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = gather8f<44 ,45 ,46 ,47 ,60 ,61 ,62 ,63>(data);
    #endif //VEC8F_AGNER
-   #ifdef VEC8D_AGNER
+   #if defined(VEC8D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather8d<0 ,1 ,2 ,3 ,16 ,17 ,18 ,19>(data);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = gather8d<32 ,33 ,34 ,35 ,48 ,49 ,50 ,51>(data);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = gather8d<4 ,5 ,6 ,7 ,20 ,21 ,22 ,23>(data);
@@ -277,7 +283,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = gather8d<44 ,45 ,46 ,47 ,60 ,61 ,62 ,63>(data);
    #endif //VEC8D_AGNER
 
-#if defined (VEC8F_FALLBACK) || defined (VEC8D_FALLBACK)
+#if defined(VEC8F_FALLBACK) || defined(VEC8D_FALLBACK) || defined(VEC8F_STDSIMD) || defined(VEC8D_STDSIMD) || (defined(VEC8D_AGNER) && defined(VEC_MIXED_PRECISION))
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[1], data[2], data[3], data[16], data[17], data[18], data[19]);
          values[i_pcolumnv_b(1, 0, block_k, n_blocks)] = Vec(data[32], data[33], data[34], data[35], data[48], data[49], data[50], data[51]);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = Vec(data[4], data[5], data[6], data[7], data[20], data[21], data[22], data[23]);
@@ -286,7 +292,7 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(1, 2, block_k, n_blocks)] = Vec(data[40], data[41], data[42], data[43], data[56], data[57], data[58], data[59]);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = Vec(data[12], data[13], data[14], data[15], data[28], data[29], data[30], data[31]);
          values[i_pcolumnv_b(1, 3, block_k, n_blocks)] = Vec(data[44], data[45], data[46], data[47], data[60], data[61], data[62], data[63]);
-#endif //VEC8F_FALLBACK || VEC8D_FALLBACK
+#endif //VEC8F_FALLBACK || VEC8D_FALLBACK || VEC8F/VEC8D_STDSIMD || mixed precision VEC8D_AGNER
 
    #ifdef VEC16F_AGNER
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather16f<0 ,1 ,2 ,3 ,16 ,17 ,18 ,19 ,32 ,33 ,34 ,35 ,48 ,49 ,50 ,51>(data);
@@ -294,12 +300,18 @@ for dimension in range(0, 2):
          values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = gather16f<8 ,9 ,10 ,11 ,24 ,25 ,26 ,27 ,40 ,41 ,42 ,43 ,56 ,57 ,58 ,59>(data);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather16f<12 ,13 ,14 ,15 ,28 ,29 ,30 ,31 ,44 ,45 ,46 ,47 ,60 ,61 ,62 ,63>(data);
    #endif //VEC16F_AGNER
-   #ifdef VEC16D_AGNER
+   #if defined(VEC16D_AGNER) && !defined(VEC_MIXED_PRECISION)
          values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = gather16d<0 ,1 ,2 ,3 ,16 ,17 ,18 ,19 ,32 ,33 ,34 ,35 ,48 ,49 ,50 ,51>(data);
          values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = gather16d<4 ,5 ,6 ,7 ,20 ,21 ,22 ,23 ,36 ,37 ,38 ,39 ,52 ,53 ,54 ,55>(data);
          values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = gather16d<8 ,9 ,10 ,11 ,24 ,25 ,26 ,27 ,40 ,41 ,42 ,43 ,56 ,57 ,58 ,59>(data);
          values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = gather16d<12 ,13 ,14 ,15 ,28 ,29 ,30 ,31 ,44 ,45 ,46 ,47 ,60 ,61 ,62 ,63>(data);
    #endif //VEC16D_AGNER
+#if defined(VEC16F_FALLBACK) || defined(VEC16F_STDSIMD)
+         values[i_pcolumnv_b(0, 0, block_k, n_blocks)] = Vec(data[0], data[1], data[2], data[3], data[16], data[17], data[18], data[19], data[32], data[33], data[34], data[35], data[48], data[49], data[50], data[51]);
+         values[i_pcolumnv_b(0, 1, block_k, n_blocks)] = Vec(data[4], data[5], data[6], data[7], data[20], data[21], data[22], data[23], data[36], data[37], data[38], data[39], data[52], data[53], data[54], data[55]);
+         values[i_pcolumnv_b(0, 2, block_k, n_blocks)] = Vec(data[8], data[9], data[10], data[11], data[24], data[25], data[26], data[27], data[40], data[41], data[42], data[43], data[56], data[57], data[58], data[59]);
+         values[i_pcolumnv_b(0, 3, block_k, n_blocks)] = Vec(data[12], data[13], data[14], data[15], data[28], data[29], data[30], data[31], data[44], data[45], data[46], data[47], data[60], data[61], data[62], data[63]);
+#endif //VEC16F_FALLBACK || VEC16F_STDSIMD
          //zero old output data
          for (uint i=0; i<WID3; ++i) {
             data[i]=0;
@@ -316,7 +328,16 @@ for dimension in range(0, 2):
          uint offset = 0;
          for (uint k=0; k<WID; ++k) {
             for(uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){
+#ifdef VEC_MIXED_PRECISION
+               // convert the single precision data to the precision of Vec
+               Realv vectorData[VECL];
+               for (uint i=0; i<VECL; ++i) {
+                  vectorData[i] = data[offset + i];
+               }
+               values[i_pcolumnv_b(planeVector, k, block_k, n_blocks)].load(vectorData);
+#else
                values[i_pcolumnv_b(planeVector, k, block_k, n_blocks)].load(data + offset);
+#endif
                offset += VECL;
             }
          }
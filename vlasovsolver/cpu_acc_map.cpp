@@ -23,7 +23,10 @@
 
 #include <cmath>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <utility>
+#include <vector>
 
 #include "vec.h"
 #include "../object_wrapper.h"
@@ -78,69 +81,135 @@ vmesh::LocalID addVelocityBlock(const vmesh::GlobalID& blockGID,
 
 
 
-void inline swapBlockIndices(velocity_block_indices_t &blockIndices, const uint dimension){
-   
+template<uint dimension>
+inline void swapBlockIndices(velocity_block_indices_t &blockIndices){
+
    uint temp;
    // Switch block indices according to dimensions, the algorithm has
    // been written for integrating along z.
-   switch (dimension){
-   case 0:
+   if constexpr (dimension == 0) {
       /*i and k coordinates have been swapped*/
       temp=blockIndices[2];
       blockIndices[2]=blockIndices[0];
       blockIndices[0]=temp;
-      break;
-   case 1:
+   }
+   if constexpr (dimension == 1) {
       /*in values j and k coordinates have been swapped*/
       temp=blockIndices[2];
       blockIndices[2]=blockIndices[1];
       blockIndices[1]=temp;
-      break;
-   case 2:
-      break;
    }
 }
 
+/** Get the array that is used to convert cell indices to id within a
+    block using a dot product. The indices are the swapped i,j,k indices,
+    where the mapping is always along k.*/
+template<uint dimension>
+constexpr std::array<uint,3> cellIndicesToId() {
+   if (dimension == 0) return {WID2, WID, 1};
+   if (dimension == 1) return {1, WID2, WID};
+   return {1, WID, WID2};
+}
 
 
-/* 
-   Here we map from the current time step grid, to a target grid which
-   is the lagrangian departure grid (so th grid at timestep +dt,
-   tracked backwards by -dt)
-
-   TODO: parallelize with openMP over block-columns. If one also
-   pre-creates new blocks in a separate loop first (serial operation),
-   then the openmp parallization would scale well (better than over
-   spatial cells), and would not need synchronization.
-   
-*/
-bool map_1d(SpatialCell* spatial_cell,
-            const uint popID,     
-            Realv intersection, Realv intersection_di, Realv intersection_dj,Realv intersection_dk,
-            const uint dimension) {
-   no_subnormals();
 
-   Realv dv,v_min;
-   Realv is_temp;
+/** Per-cell parameters of a 1D mapping along one dimension. These are
+    shared by all column sets of the cell, and computed by setup_map_1d.*/
+struct Map1dParameters {
+   Realv intersection;
+   Realv intersection_di;
+   Realv intersection_dj;
+   Realv intersection_dk;
+   Realv dv;
+   Realv v_min;
    int max_v_length;
-   uint block_indices_to_id[3] = {0, 0, 0}; /*< used when computing id of target block, 0 for compiler */
-   uint cell_indices_to_id[3] = {0, 0, 0}; /*< used when computing id of target cell in block, 0 for compiler */
+   uint block_indices_to_id[3]; /*< used when computing id of target block */
+};
 
-   vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh    = spatial_cell->get_velocity_mesh(popID);
-   vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks(popID);
+/** Scratch buffers of map_1d and map_3d_fused. There is one arena per
+    thread. The buffers grow to the size needed by the largest cell seen
+    so far, and are only cleared between calls, so that in
+    the steady state the mapping does no heap allocations.*/
+struct Map1dArena {
+   std::vector<vmesh::GlobalID> blocks;
+   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > blockPairs;
+   std::vector<uint> columnBlockOffsets;
+   std::vector<uint> columnNumBlocks;
+   std::vector<uint> setColumnOffsets;
+   std::vector<uint> setNumColumns;
+   std::vector<int> columnMinBlockK;
+   std::vector<int> columnMaxBlockK;
+   std::vector<Realv> box;             /*< dense velocity box of map_3d_fused */
+   std::vector<Vec> boxColumn;         /*< source values of one line of the box, padded with WID zeros */
+   std::vector<Vec> boxTarget;         /*< target values of one line of the box */
+   std::vector<uint8_t> boxHasContent; /*< per box block, true if it has non-zero values after the mapping */
+   size_t reportedBytes {0}; /*< bytes of this arena included in map1dArenaBytes */
 
-   //nothing to do if no blocks
-   if(vmesh.size() == 0)
-      return true;
+   void reset() {
+      blocks.clear();
+      blockPairs.clear();
+      columnBlockOffsets.clear();
+      columnNumBlocks.clear();
+      setColumnOffsets.clear();
+      setNumColumns.clear();
+      columnMinBlockK.clear();
+      columnMaxBlockK.clear();
+      boxHasContent.clear();
+   }
+
+   size_t capacityBytes() const {
+      return blocks.capacity()*sizeof(vmesh::GlobalID)
+         + blockPairs.capacity()*sizeof(std::pair<vmesh::GlobalID,vmesh::GlobalID>)
+         + (columnBlockOffsets.capacity() + columnNumBlocks.capacity()
+            + setColumnOffsets.capacity() + setNumColumns.capacity())*sizeof(uint)
+         + (columnMinBlockK.capacity() + columnMaxBlockK.capacity())*sizeof(int)
+         + box.capacity()*sizeof(Realv)
+         + (boxColumn.capacity() + boxTarget.capacity())*sizeof(Vec)
+         + boxHasContent.capacity()*sizeof(uint8_t);
+   }
+};
 
+/** Total number of bytes held by the map_1d arenas of all threads.*/
+static std::atomic<size_t> map1dArenaBytes {0};
+
+/** Get the map_1d arena of the calling thread, cleared for a new call.*/
+static Map1dArena& getMap1dArena() {
+   static thread_local Map1dArena arena;
+   arena.reset();
+   return arena;
+}
+
+/** Update map1dArenaBytes after the arena has been used, its buffers
+    may have grown during the call.*/
+static void updateMap1dArenaBytes(Map1dArena& arena) {
+   const size_t bytes = arena.capacityBytes();
+   if (bytes != arena.reportedBytes) {
+      map1dArenaBytes += bytes - arena.reportedBytes;
+      arena.reportedBytes = bytes;
+   }
+}
+
+size_t getMap1dArenaBytes() {
+   return map1dArenaBytes;
+}
+
+/* Compute the dimension dependent parameters of the mapping, i.e., swap
+   the intersections and set the block index to id conversion array so
+   that the algorithm can be written for integrating along z.
+*/
+static void setup_map_1d(const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                         Realv intersection, Realv intersection_di, Realv intersection_dj,Realv intersection_dk,
+                         const uint dimension,
+                         Map1dParameters& mp) {
+   Realv is_temp;
 
    // Velocity grid refinement level, has no effect but is 
    // needed in some vmesh::VelocityMesh function calls.
    const uint8_t REFLEVEL = 0;
 
-   dv            = vmesh.getCellSize(REFLEVEL)[dimension];
-   v_min         = vmesh.getMeshMinLimits()[dimension];
-   max_v_length  = vmesh.getGridLength(REFLEVEL)[dimension];
+   mp.dv            = vmesh.getCellSize(REFLEVEL)[dimension];
+   mp.v_min         = vmesh.getMeshMinLimits()[dimension];
+   mp.max_v_length  = vmesh.getGridLength(REFLEVEL)[dimension];
 
    switch (dimension) {
     case 0:
@@ -152,14 +221,9 @@ bool map_1d(SpatialCell* spatial_cell,
       intersection_dk=is_temp;
 
       /*set values in array that is used to convert block indices to id using a dot product*/
-      block_indices_to_id[0] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
-      block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0];
-      block_indices_to_id[2] = 1;
-
-      /*set values in array that is used to convert block indices to id using a dot product*/
-      cell_indices_to_id[0]=WID2;
-      cell_indices_to_id[1]=WID;
-      cell_indices_to_id[2]=1;
+      mp.block_indices_to_id[0] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
+      mp.block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0];
+      mp.block_indices_to_id[2] = 1;
       break;
     case 1:
       /* j and k coordinates have been swapped*/
@@ -170,45 +234,87 @@ bool map_1d(SpatialCell* spatial_cell,
       intersection_dk=is_temp;
       
       /*set values in array that is used to convert block indices to id using a dot product*/
-      block_indices_to_id[0]=1;
-      block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
-      block_indices_to_id[2] = vmesh.getGridLength(REFLEVEL)[0];
-      
-      /*set values in array that is used to convert block indices to id using a dot product*/
-      cell_indices_to_id[0]=1;
-      cell_indices_to_id[1]=WID2;
-      cell_indices_to_id[2]=WID;
+      mp.block_indices_to_id[0]=1;
+      mp.block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
+      mp.block_indices_to_id[2] = vmesh.getGridLength(REFLEVEL)[0];
       break;
     case 2:
       /*set values in array that is used to convert block indices to id using a dot product*/
-      block_indices_to_id[0]=1;
-      block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0];
-      block_indices_to_id[2] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
-      
-      // set values in array that is used to convert block indices to id using a dot product.
-      cell_indices_to_id[0]=1;
-      cell_indices_to_id[1]=WID;
-      cell_indices_to_id[2]=WID2;
+      mp.block_indices_to_id[0]=1;
+      mp.block_indices_to_id[1] = vmesh.getGridLength(REFLEVEL)[0];
+      mp.block_indices_to_id[2] = vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1];
       break;
    }
-   
+
+   mp.intersection    = intersection;
+   mp.intersection_di = intersection_di;
+   mp.intersection_dj = intersection_dj;
+   mp.intersection_dk = intersection_dk;
+}
+
+/* Bail out if the target blocks firstBlockIndexK...lastBlockIndexK of a
+   mapping come closer than bailout.velocity_space_wall_block_margin blocks
+   to the velocity space walls.
+*/
+static void checkVelocitySpaceWallMargin(SpatialCell* spatial_cell, const uint popID,
+                                         const int firstBlockIndexK, const int lastBlockIndexK,
+                                         const int max_v_length) {
+   const int wallmargin = Parameters::bailout_velocity_space_wall_margin;
+   if(firstBlockIndexK < wallmargin
+      || firstBlockIndexK >= max_v_length - wallmargin
+      || lastBlockIndexK < wallmargin
+      || lastBlockIndexK >= max_v_length - wallmargin
+   ) {
+      string message = "Some target blocks in acceleration are going to be less than ";
+      message += std::to_string(wallmargin);
+      message += " blocks away from the current velocity space walls for population ";
+      message += getObjectWrapper().particleSpecies[popID].name;
+      message += " at CellID ";
+      message += std::to_string(static_cast<int>(spatial_cell->parameters[CellParams::CELLID]));
+      message += ". Consider expanding velocity space for that population.";
+      bailout(true, message, __FILE__, __LINE__);
+   }
+}
+
+/* Map one column set, i.e., all columns along the dimension with the
+   other block indices being equal. Target blocks that do not yet exist
+   are created and source blocks that are not target blocks are removed.
+
+   blocks contains the sorted global IDs of the cell, and the column
+   vectors are the ones produced by sortBlocklistByDimension for this
+   cell. columnMinBlockK and columnMaxBlockK are indexed with the column
+   index and are set here.
+
+   The dimension and the reconstruction (one of accReconstruction::Order)
+   are template parameters, so that the stride arithmetic and the choice
+   of reconstruction are resolved at compile time. All variants are
+   compiled, getColumnSetMapper selects the one to use.
+*/
+template<uint dimension, int reconstruction>
+static void map_1d_column_set(SpatialCell* spatial_cell,
+                              const uint popID,
+                              const Map1dParameters& mp,
+                              vmesh::GlobalID* blocks,
+                              const std::vector<uint>& columnBlockOffsets,
+                              const std::vector<uint>& columnNumBlocks,
+                              const uint setColumnOffset,
+                              const uint setNumColumns,
+                              std::vector<int>& columnMinBlockK,
+                              std::vector<int>& columnMaxBlockK) {
+   vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh    = spatial_cell->get_velocity_mesh(popID);
+   vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks(popID);
+
+   const Realv intersection    = mp.intersection;
+   const Realv intersection_di = mp.intersection_di;
+   const Realv intersection_dj = mp.intersection_dj;
+   const Realv intersection_dk = mp.intersection_dk;
+   const Realv dv              = mp.dv;
+   const Realv v_min           = mp.v_min;
+   const int max_v_length      = mp.max_v_length;
+   const uint* block_indices_to_id = mp.block_indices_to_id;
+   constexpr std::array<uint,3> cell_indices_to_id = cellIndicesToId<dimension>();
    const Realv i_dv=1.0/dv;
 
-   // sort blocks according to dimension, and divide them into columns
-   vmesh::LocalID* blocks = new vmesh::LocalID[vmesh.size()];
-   std::vector<uint> columnBlockOffsets;
-   std::vector<uint> columnNumBlocks;
-   std::vector<uint> setColumnOffsets;
-   std::vector<uint> setNumColumns;
-   std::vector<int> columnMinBlockK;
-   std::vector<int> columnMaxBlockK;
-   
-   sortBlocklistByDimension(vmesh, dimension, blocks,
-                            columnBlockOffsets, columnNumBlocks,
-                            setColumnOffsets, setNumColumns);
-   
-   // loop over block column sets  (all columns along the dimension with the other dimensions being equal )
-      
 /*   
      values array used to store column data The max size is the worst
      case scenario with every second block having content, creating up
@@ -221,368 +327,802 @@ bool map_1d(SpatialCell* spatial_cell,
    bool isTargetBlock[MAX_BLOCKS_PER_DIM];
    bool isSourceBlock[MAX_BLOCKS_PER_DIM];
 
-   for(uint setIndex=0; setIndex< setColumnOffsets.size(); ++setIndex) {
-      uint8_t refLevel = 0;
-      //init 
-      for (uint blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
-         blockIndexToBlockData[blockK] =  NULL;
-         isTargetBlock[blockK] = false;
-         isSourceBlock[blockK] = false;
-      }
-      
-      //Load data into values array (this also zeroes the original data)
-      uint valuesColumnOffset = 0; //offset to values array for data in a column in this set
-      for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
-         const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
-         loadColumnBlockData(vmesh, blockContainer, cblocks, n_cblocks, dimension, values + valuesColumnOffset);
-         valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL); // there are WID3/VECL elements of type Vec per block
-      }
+   uint8_t refLevel = 0;
+   //init 
+   for (uint blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
+      blockIndexToBlockData[blockK] =  NULL;
+      isTargetBlock[blockK] = false;
+      isSourceBlock[blockK] = false;
+   }
+   
+   //Load data into values array (this also zeroes the original data)
+   uint valuesColumnOffset = 0; //offset to values array for data in a column in this set
+   for(uint columnIndex = setColumnOffset; columnIndex < setColumnOffset + setNumColumns ; columnIndex ++){
+      const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
+      vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+      loadColumnBlockData(vmesh, blockContainer, cblocks, n_cblocks, dimension, values + valuesColumnOffset);
+      valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL); // there are WID3/VECL elements of type Vec per block
+   }
 
 
-      /*need x,y coordinate of this column set of blocks, take it from first
-        block in first column*/
-      velocity_block_indices_t setFirstBlockIndices;
-      vmesh.getIndices(blocks[columnBlockOffsets[setColumnOffsets[setIndex]]],
+   /*need x,y coordinate of this column set of blocks, take it from first
+     block in first column*/
+   velocity_block_indices_t setFirstBlockIndices;
+   vmesh.getIndices(blocks[columnBlockOffsets[setColumnOffset]],
+                    refLevel, 
+                    setFirstBlockIndices[0], setFirstBlockIndices[1], setFirstBlockIndices[2]);
+   swapBlockIndices<dimension>(setFirstBlockIndices);
+   /*compute the maximum starting point of the lagrangian (target) grid
+     (base level) within the 4 corner cells in this
+     block. Needed for computing maximum extent of target column*/
+   
+   Realv max_intersectionMin = intersection +
+                                   (setFirstBlockIndices[0] * WID + 0) * intersection_di +
+                                   (setFirstBlockIndices[1] * WID + 0) * intersection_dj;
+   max_intersectionMin =  std::max(max_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + 0) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
+   max_intersectionMin =  std::max(max_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + 0) * intersection_dj);
+   max_intersectionMin =  std::max(max_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
+   
+   Realv min_intersectionMin = intersection +
+                                   (setFirstBlockIndices[0] * WID + 0) * intersection_di +
+                                   (setFirstBlockIndices[1] * WID + 0) * intersection_dj;
+   min_intersectionMin =  std::min(min_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + 0) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
+   min_intersectionMin =  std::min(min_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + 0) * intersection_dj);
+   min_intersectionMin =  std::min(min_intersectionMin,
+                                   intersection +
+                                   (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
+                                   (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
+
+   //now, record which blocks are target blocks
+   for(uint columnIndex = setColumnOffset; columnIndex < setColumnOffset + setNumColumns ; columnIndex ++){
+      const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
+      vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+      velocity_block_indices_t firstBlockIndices;
+      velocity_block_indices_t lastBlockIndices;
+      vmesh.getIndices(cblocks[0],
+                       refLevel, 
+                       firstBlockIndices[0], firstBlockIndices[1], firstBlockIndices[2]);
+      vmesh.getIndices(cblocks[n_cblocks -1],
                        refLevel, 
-                       setFirstBlockIndices[0], setFirstBlockIndices[1], setFirstBlockIndices[2]);
-      swapBlockIndices(setFirstBlockIndices, dimension);
-      /*compute the maximum starting point of the lagrangian (target) grid
-        (base level) within the 4 corner cells in this
-        block. Needed for computing maximum extent of target column*/
+                       lastBlockIndices[0], lastBlockIndices[1], lastBlockIndices[2]);
+      swapBlockIndices<dimension>(firstBlockIndices);
+      swapBlockIndices<dimension>(lastBlockIndices);
       
-      Realv max_intersectionMin = intersection +
-                                      (setFirstBlockIndices[0] * WID + 0) * intersection_di +
-                                      (setFirstBlockIndices[1] * WID + 0) * intersection_dj;
-      max_intersectionMin =  std::max(max_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + 0) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
-      max_intersectionMin =  std::max(max_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + 0) * intersection_dj);
-      max_intersectionMin =  std::max(max_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
+      /*firstBlockV is in z the minimum velocity value of the lower
+       * edge in source grid.
+        *lastBlockV is in z the maximum velocity value of the upper
+       * edge in source grid. Added 1.01*dv to account for unexpected issues*/ 
+      double firstBlockMinV = (WID * firstBlockIndices[2]) * dv + v_min;
+      double lastBlockMaxV = (WID * (lastBlockIndices[2] + 1)) * dv + v_min;
       
-      Realv min_intersectionMin = intersection +
-                                      (setFirstBlockIndices[0] * WID + 0) * intersection_di +
-                                      (setFirstBlockIndices[1] * WID + 0) * intersection_dj;
-      min_intersectionMin =  std::min(min_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + 0) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
-      min_intersectionMin =  std::min(min_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + 0) * intersection_dj);
-      min_intersectionMin =  std::min(min_intersectionMin,
-                                      intersection +
-                                      (setFirstBlockIndices[0] * WID + WID - 1) * intersection_di + 
-                                      (setFirstBlockIndices[1] * WID + WID - 1) * intersection_dj);
-
-      //now, record which blocks are target blocks
-      for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
-         const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
-         velocity_block_indices_t firstBlockIndices;
-         velocity_block_indices_t lastBlockIndices;
-         vmesh.getIndices(cblocks[0],
-                          refLevel, 
-                          firstBlockIndices[0], firstBlockIndices[1], firstBlockIndices[2]);
-         vmesh.getIndices(cblocks[n_cblocks -1],
-                          refLevel, 
-                          lastBlockIndices[0], lastBlockIndices[1], lastBlockIndices[2]);
-         swapBlockIndices(firstBlockIndices, dimension);
-         swapBlockIndices(lastBlockIndices, dimension);
-         
-         /*firstBlockV is in z the minimum velocity value of the lower
-          * edge in source grid.
-           *lastBlockV is in z the maximum velocity value of the upper
-          * edge in source grid. Added 1.01*dv to account for unexpected issues*/ 
-         double firstBlockMinV = (WID * firstBlockIndices[2]) * dv + v_min;
-         double lastBlockMaxV = (WID * (lastBlockIndices[2] + 1)) * dv + v_min;
-         
-         /*gk is now the k value in terms of cells in target
-         grid. This distance between max_intersectionMin (so lagrangian
-         plan, well max value here) and V of source grid, divided by
-         intersection_dk to find out how many grid cells that is*/
-         const int firstBlock_gk = (int)((firstBlockMinV - max_intersectionMin)/intersection_dk);
-         const int lastBlock_gk = (int)((lastBlockMaxV - min_intersectionMin)/intersection_dk);
-
-         int firstBlockIndexK = firstBlock_gk/WID;
-         int lastBlockIndexK = lastBlock_gk/WID;
-         int wallmargin = Parameters::bailout_velocity_space_wall_margin;
-         //now enforce mesh limits for target column blocks
-         firstBlockIndexK = (firstBlockIndexK >= 0)            ? firstBlockIndexK : 0;
-         firstBlockIndexK = (firstBlockIndexK < max_v_length ) ? firstBlockIndexK : max_v_length - 1;
-         lastBlockIndexK  = (lastBlockIndexK  >= 0)            ? lastBlockIndexK  : 0;
-         lastBlockIndexK  = (lastBlockIndexK  < max_v_length ) ? lastBlockIndexK  : max_v_length - 1;
-         if(firstBlockIndexK < wallmargin
-            || firstBlockIndexK >= max_v_length - wallmargin
-            || lastBlockIndexK < wallmargin
-            || lastBlockIndexK >= max_v_length - wallmargin
-         ) {
-            string message = "Some target blocks in acceleration are going to be less than ";
-            message += std::to_string(wallmargin);
-            message += " blocks away from the current velocity space walls for population ";
-            message += getObjectWrapper().particleSpecies[popID].name;
-            message += " at CellID ";
-            message += std::to_string(static_cast<int>(spatial_cell->parameters[CellParams::CELLID]));
-            message += ". Consider expanding velocity space for that population.";
-            bailout(true, message, __FILE__, __LINE__);
-         }
-         
-         //store source blocks
-         for (uint blockK = firstBlockIndices[2]; blockK <= lastBlockIndices[2]; blockK++){
-            isSourceBlock[blockK] = true;
-         }
-         
-         //store target blocks
-         for (uint blockK = firstBlockIndexK; (int)blockK <= lastBlockIndexK; blockK++){
-            isTargetBlock[blockK]=true;
-         }
+      /*gk is now the k value in terms of cells in target
+      grid. This distance between max_intersectionMin (so lagrangian
+      plan, well max value here) and V of source grid, divided by
+      intersection_dk to find out how many grid cells that is*/
+      const int firstBlock_gk = (int)((firstBlockMinV - max_intersectionMin)/intersection_dk);
+      const int lastBlock_gk = (int)((lastBlockMaxV - min_intersectionMin)/intersection_dk);
 
-         //store also for each column firstBlockIndexK, and lastBlockIndexK
-         columnMinBlockK.push_back(firstBlockIndexK);
-         columnMaxBlockK.push_back(lastBlockIndexK);
+      int firstBlockIndexK = firstBlock_gk/WID;
+      int lastBlockIndexK = lastBlock_gk/WID;
+      //now enforce mesh limits for target column blocks
+      firstBlockIndexK = (firstBlockIndexK >= 0)            ? firstBlockIndexK : 0;
+      firstBlockIndexK = (firstBlockIndexK < max_v_length ) ? firstBlockIndexK : max_v_length - 1;
+      lastBlockIndexK  = (lastBlockIndexK  >= 0)            ? lastBlockIndexK  : 0;
+      lastBlockIndexK  = (lastBlockIndexK  < max_v_length ) ? lastBlockIndexK  : max_v_length - 1;
+      checkVelocitySpaceWallMargin(spatial_cell, popID, firstBlockIndexK, lastBlockIndexK, max_v_length);
+      
+      //store source blocks
+      for (uint blockK = firstBlockIndices[2]; blockK <= lastBlockIndices[2]; blockK++){
+         isSourceBlock[blockK] = true;
+      }
+      
+      //store target blocks
+      for (uint blockK = firstBlockIndexK; (int)blockK <= lastBlockIndexK; blockK++){
+         isTargetBlock[blockK]=true;
       }
 
-      //now add target blocks that do not yet exist and remove source blocks
-      //that are not target blocks
-      for (uint blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
-         if(isTargetBlock[blockK] && !isSourceBlock[blockK] )  {
-            const int targetBlock =
-               setFirstBlockIndices[0] * block_indices_to_id[0] +
-               setFirstBlockIndices[1] * block_indices_to_id[1] +
-               blockK                  * block_indices_to_id[2];
-            addVelocityBlock(targetBlock, vmesh, blockContainer);
-            
-         }
-         if(!isTargetBlock[blockK] && isSourceBlock[blockK] )  {
-            const int targetBlock =
-               setFirstBlockIndices[0] * block_indices_to_id[0] +
-               setFirstBlockIndices[1] * block_indices_to_id[1] +
-               blockK                  * block_indices_to_id[2];
+      //store also for each column firstBlockIndexK, and lastBlockIndexK
+      columnMinBlockK[columnIndex] = firstBlockIndexK;
+      columnMaxBlockK[columnIndex] = lastBlockIndexK;
+   }
 
-            spatial_cell->remove_velocity_block(targetBlock, popID);
+   //now add target blocks that do not yet exist and remove source blocks
+   //that are not target blocks
+   for (uint blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
+      if(isTargetBlock[blockK] && !isSourceBlock[blockK] )  {
+         const int targetBlock =
+            setFirstBlockIndices[0] * block_indices_to_id[0] +
+            setFirstBlockIndices[1] * block_indices_to_id[1] +
+            blockK                  * block_indices_to_id[2];
+         if (addVelocityBlock(targetBlock, vmesh, blockContainer) != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
+            spatial_cell->get_velocity_block_sort_index(popID).added(targetBlock);
          }
+         
       }
+      if(!isTargetBlock[blockK] && isSourceBlock[blockK] )  {
+         const int targetBlock =
+            setFirstBlockIndices[0] * block_indices_to_id[0] +
+            setFirstBlockIndices[1] * block_indices_to_id[1] +
+            blockK                  * block_indices_to_id[2];
 
-     /*now store pointer to blocks, cannot do it at the same time as adding
-      them since they might move due to re-allocations or migrated when
-      removing blocks*/
-      for (int blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
-         if(isTargetBlock[blockK])  {
-            const int targetBlock =
-               setFirstBlockIndices[0] * block_indices_to_id[0] +
-               setFirstBlockIndices[1] * block_indices_to_id[1] +
-               blockK                  * block_indices_to_id[2];
-            const vmesh::LocalID tblockLID = vmesh.getLocalID(targetBlock);
-            // Get pointer to target block data.
-            blockIndexToBlockData[blockK] = blockContainer.getData(tblockLID);
-         }
+         spatial_cell->remove_velocity_block(targetBlock, popID);
       }
+   }
+
+  /*now store pointer to blocks, cannot do it at the same time as adding
+   them since they might move due to re-allocations or migrated when
+   removing blocks*/
+   for (int blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
+      if(isTargetBlock[blockK])  {
+         const int targetBlock =
+            setFirstBlockIndices[0] * block_indices_to_id[0] +
+            setFirstBlockIndices[1] * block_indices_to_id[1] +
+            blockK                  * block_indices_to_id[2];
+         const vmesh::LocalID tblockLID = vmesh.getLocalID(targetBlock);
+         // Get pointer to target block data.
+         blockIndexToBlockData[blockK] = blockContainer.getData(tblockLID);
+      }
+   }
+   
+   
+   
+   // loop over columns in set and do the mapping
+   valuesColumnOffset = 0; //offset to values array for data in a column in this set
+   for(uint columnIndex = setColumnOffset; columnIndex < setColumnOffset + setNumColumns ; columnIndex ++){
+      const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
+      vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+   
+      // compute the common indices for this block column set
+      //First block in column
+      velocity_block_indices_t block_indices_begin;
+      uint8_t refLevel;
+      vmesh.getIndices(cblocks[0],refLevel,block_indices_begin[0],block_indices_begin[1],block_indices_begin[2]);
       
-      
-      
-      // loop over columns in set and do the mapping
-      valuesColumnOffset = 0; //offset to values array for data in a column in this set
-      for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
-         const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
-      
-         // compute the common indices for this block column set
-         //First block in column
-         velocity_block_indices_t block_indices_begin;
-         uint8_t refLevel;
-         vmesh.getIndices(cblocks[0],refLevel,block_indices_begin[0],block_indices_begin[1],block_indices_begin[2]);
-         
-         // Switch block indices according to dimensions, the algorithm has
-         // been written for integrating along z.
-         swapBlockIndices(block_indices_begin, dimension);
-
-         /*  i,j,k are now relative to the order in which we copied data to the values array. 
-             After this point in the k,j,i loops there should be no branches based on dimensions
-          
-             Note that the i dimension is vectorized, and thus there are no loops over i
-         */
-         for (int j = 0; j < WID; j += VECL/WID){
-            // create vectors with the i and j indices in the vector position on the plane.
-            #if VECL == 4       
-            const Veci i_indices = Veci(0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j);
-            #elif VECL == 8
-            const Veci i_indices = Veci(0, 1, 2, 3,
-                                        0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j,
-                                        j + 1, j + 1, j + 1, j + 1);
-            #elif VECL == 16
-            const Veci i_indices = Veci(0, 1, 2, 3,
-                                        0, 1, 2, 3,
-                                        0, 1, 2, 3,
-                                        0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j,
-                                        j + 1, j + 1, j + 1, j + 1,
-                                        j + 2, j + 2, j + 2, j + 2,
-                                        j + 3, j + 3, j + 3, j + 3);
-            #endif
-
-            const Veci  target_cell_index_common =
-               i_indices * cell_indices_to_id[0] +
-               j_indices * cell_indices_to_id[1];
-       
-            /* 
-               intersection_min is the intersection z coordinate (z after
-               swaps that is) of the lowest possible z plane for each i,j
-               index (i in vector)
-            */
+      // Switch block indices according to dimensions, the algorithm has
+      // been written for integrating along z.
+      swapBlockIndices<dimension>(block_indices_begin);
+
+      /*  i,j,k are now relative to the order in which we copied data to the values array. 
+          After this point in the k,j,i loops there should be no branches based on dimensions
        
-            const Vec intersection_min =
-               intersection +
-               (block_indices_begin[0] * WID + to_realv(i_indices)) * intersection_di + 
-               (block_indices_begin[1] * WID + to_realv(j_indices)) * intersection_dj;
-            
-            /*compute some initial values, that are used to set up the
-             * shifting of values as we go through all blocks in
-             * order. See comments where they are shifted for
-             * explanations of their meaning*/
-            Vec v_r((WID * block_indices_begin[2]) * dv + v_min);
-            Vec lagrangian_v_r((v_r-intersection_min)/intersection_dk);
+          Note that the i dimension is vectorized, and thus there are no loops over i
+      */
+      for (int j = 0; j < WID; j += VECL/WID){
+         // create vectors with the i and j indices in the vector position on the plane.
+         #if VECL == 4       
+         const Veci i_indices = Veci(0, 1, 2, 3);
+         const Veci j_indices = Veci(j, j, j, j);
+         #elif VECL == 8
+         const Veci i_indices = Veci(0, 1, 2, 3,
+                                     0, 1, 2, 3);
+         const Veci j_indices = Veci(j, j, j, j,
+                                     j + 1, j + 1, j + 1, j + 1);
+         #elif VECL == 16
+         const Veci i_indices = Veci(0, 1, 2, 3,
+                                     0, 1, 2, 3,
+                                     0, 1, 2, 3,
+                                     0, 1, 2, 3);
+         const Veci j_indices = Veci(j, j, j, j,
+                                     j + 1, j + 1, j + 1, j + 1,
+                                     j + 2, j + 2, j + 2, j + 2,
+                                     j + 3, j + 3, j + 3, j + 3);
+         #endif
+
+         const Veci  target_cell_index_common =
+            i_indices * cell_indices_to_id[0] +
+            j_indices * cell_indices_to_id[1];
+    
+         /* 
+            intersection_min is the intersection z coordinate (z after
+            swaps that is) of the lowest possible z plane for each i,j
+            index (i in vector)
+         */
+    
+         const Vec intersection_min =
+            intersection +
+            (block_indices_begin[0] * WID + to_realv(i_indices)) * intersection_di + 
+            (block_indices_begin[1] * WID + to_realv(j_indices)) * intersection_dj;
+         
+         /*compute some initial values, that are used to set up the
+          * shifting of values as we go through all blocks in
+          * order. See comments where they are shifted for
+          * explanations of their meaning*/
+         Vec v_r((WID * block_indices_begin[2]) * dv + v_min);
+         Vec lagrangian_v_r((v_r-intersection_min)/intersection_dk);
 #if VECTORCLASS_H >= 20000
-            Veci lagrangian_gk_r=truncatei(lagrangian_v_r);
+         Veci lagrangian_gk_r=truncatei(lagrangian_v_r);
 #else
-            Veci lagrangian_gk_r=truncate_to_int(lagrangian_v_r);
+         Veci lagrangian_gk_r=truncate_to_int(lagrangian_v_r);
 #endif
 
-            /*compute location of min and max, this does not change for one
-             * column (or even for this set of intersections, and can be used
-             * to quickly compute max and min later on*/
-            //TODO, these can be computed much earlier, since they are
-            //identiacal for each set of intersections
-            int minGkIndex=0, maxGkIndex=0; // 0 for compiler
-            {
-               Realv maxV = std::numeric_limits<Realv>::min();
-               Realv minV = std::numeric_limits<Realv>::max();
-               for(int i = 0; i < VECL; i++) {
-                  if ( lagrangian_v_r[i] > maxV) {
-                     maxV = lagrangian_v_r[i];
-                     maxGkIndex = i;
-                  }
-                  if ( lagrangian_v_r[i] < minV) {
-                     minV = lagrangian_v_r[i];
-                     minGkIndex = i;
-                  }
+         /*compute location of min and max, this does not change for one
+          * column (or even for this set of intersections, and can be used
+          * to quickly compute max and min later on*/
+         //TODO, these can be computed much earlier, since they are
+         //identiacal for each set of intersections
+         int minGkIndex=0, maxGkIndex=0; // 0 for compiler
+         {
+            Realv maxV = std::numeric_limits<Realv>::lowest();
+            Realv minV = std::numeric_limits<Realv>::max();
+            for(int i = 0; i < VECL; i++) {
+               if ( lagrangian_v_r[i] > maxV) {
+                  maxV = lagrangian_v_r[i];
+                  maxGkIndex = i;
+               }
+               if ( lagrangian_v_r[i] < minV) {
+                  minV = lagrangian_v_r[i];
+                  minGkIndex = i;
                }
             }
-            
-            
-            // loop through all blocks in column and compute the mapping as integrals.
-            for (uint k=0; k < WID * n_cblocks; ++k ){
-               // Compute reconstructions 
-               // values + i_pcolumnv(n_cblocks, -1, j, 0) is the starting point of the column data for fixed j
-               // k + WID is the index where we have stored k index, WID amount of padding.
-               #ifdef ACC_SEMILAG_PLM
-               Vec a[2];
+         }
+         
+         
+         // loop through all blocks in column and compute the mapping as integrals.
+         for (uint k=0; k < WID * n_cblocks; ++k ){
+            // Compute reconstructions 
+            // values + i_pcolumnv(n_cblocks, -1, j, 0) is the starting point of the column data for fixed j
+            // k + WID is the index where we have stored k index, WID amount of padding.
+            Vec a[reconstruction == accReconstruction::PLM ? 2 : reconstruction == accReconstruction::PPM ? 3 : 5];
+            if constexpr (reconstruction == accReconstruction::PLM) {
                compute_plm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), k + WID , a, spatial_cell->getVelocityBlockMinValue(popID));
-               #endif
-               #ifdef ACC_SEMILAG_PPM
-               Vec a[3];
+            }
+            if constexpr (reconstruction == accReconstruction::PPM) {
                compute_ppm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), h4, k + WID, a, spatial_cell->getVelocityBlockMinValue(popID));
-               #endif
-               #ifdef ACC_SEMILAG_PQM
-               Vec a[5];
+            }
+            if constexpr (reconstruction == accReconstruction::PQM) {
                compute_pqm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), h8, k + WID, a, spatial_cell->getVelocityBlockMinValue(popID));
-               #endif
-               
-               // set the initial value for the integrand at the boundary at v = 0 
-               // (in reduced cell units), this will be shifted to target_density_1, see below.
-               Vec target_density_r(0.0);
-               // v_l, v_r are the left and right velocity coordinates of source cell. Left is the old right.
-               Vec v_l = v_r; 
-               v_r += dv;
-               
-               // left(l) and right(r) k values (global index) in the target
-               // Lagrangian grid, the intersecting cells. Again old right is new left.
-               const Veci lagrangian_gk_l = lagrangian_gk_r;
+            }
+            
+            // set the initial value for the integrand at the boundary at v = 0 
+            // (in reduced cell units), this will be shifted to target_density_1, see below.
+            Vec target_density_r(0.0);
+            // v_l, v_r are the left and right velocity coordinates of source cell. Left is the old right.
+            Vec v_l = v_r; 
+            v_r += dv;
+            
+            // left(l) and right(r) k values (global index) in the target
+            // Lagrangian grid, the intersecting cells. Again old right is new left.
+            const Veci lagrangian_gk_l = lagrangian_gk_r;
 #if VECTORCLASS_H >= 20000
-               lagrangian_gk_r = truncatei((v_r-intersection_min)/intersection_dk);
+            lagrangian_gk_r = truncatei((v_r-intersection_min)/intersection_dk);
 #else
-               lagrangian_gk_r = truncate_to_int((v_r-intersection_min)/intersection_dk);
+            lagrangian_gk_r = truncate_to_int((v_r-intersection_min)/intersection_dk);
 #endif
+            
+            //limits in lagrangian k for target column. Also take into
+            //account limits of target column
+            int minGk = std::max(int(lagrangian_gk_l[minGkIndex]), int(columnMinBlockK[columnIndex] * WID));
+            int maxGk = std::min(int(lagrangian_gk_r[maxGkIndex]), int((columnMaxBlockK[columnIndex] + 1) * WID - 1));
+            
+            for(int gk = minGk; gk <= maxGk; gk++){ 
+               const int blockK = gk/WID;
+               const int gk_mod_WID = (gk - blockK * WID);
+
+               
+               //cell indices in the target block  (TODO: to be replaced by
+               //compile time generated scatter write operation)
+               const Veci target_cell(target_cell_index_common + gk_mod_WID * cell_indices_to_id[2]);
+            
+               //the velocity between which we will integrate to put mass
+               //in the targe cell. If both v_r and v_l are in same cell
+               //then v_1,v_2 should be between v_l and v_r.
+               //v_1 and v_2 normalized to be between 0 and 1 in the cell.
+               //For vector elements where gk is already larger than needed (lagrangian_gk_r), v_2=v_1=v_r and thus the value is zero.
+               const Vec v_norm_r = (  min(  max( (gk + 1) * intersection_dk + intersection_min, v_l), v_r) - v_l) * i_dv;
+               /*shift, old right is new left*/
+               const Vec target_density_l = target_density_r;
+
+               // compute right integrand
+               if constexpr (reconstruction == accReconstruction::PLM) {
+                  target_density_r =
+                     v_norm_r * ( a[0] + v_norm_r * a[1] );
+               }
+               if constexpr (reconstruction == accReconstruction::PPM) {
+                  target_density_r =
+                     v_norm_r * ( a[0] + v_norm_r * ( a[1] + v_norm_r * a[2] ) );
+               }
+               if constexpr (reconstruction == accReconstruction::PQM) {
+                  target_density_r =
+                     v_norm_r * ( a[0] + v_norm_r * ( a[1] + v_norm_r * ( a[2] + v_norm_r * ( a[3] + v_norm_r * a[4] ) ) ) );
+               }
+               
+               //store values, one element at a time. All blocks
+               //have been created by now.
+               //TODO replace by vector version & scatter & gather operation
                
-               //limits in lagrangian k for target column. Also take into
-               //account limits of target column
-               int minGk = std::max(int(lagrangian_gk_l[minGkIndex]), int(columnMinBlockK[columnIndex] * WID));
-               int maxGk = std::min(int(lagrangian_gk_r[maxGkIndex]), int((columnMaxBlockK[columnIndex] + 1) * WID - 1));
                
-               for(int gk = minGk; gk <= maxGk; gk++){ 
-                  const int blockK = gk/WID;
-                  const int gk_mod_WID = (gk - blockK * WID);
-
-                  
-                  //cell indices in the target block  (TODO: to be replaced by
-                  //compile time generated scatter write operation)
-                  const Veci target_cell(target_cell_index_common + gk_mod_WID * cell_indices_to_id[2]);
+               //With mixed precision the block data cannot be loaded
+               //directly into a Vec, and all dimensions use the
+               //element-wise update which also converts the values.
+#ifndef VEC_MIXED_PRECISION
+               if constexpr (dimension == 2) {
+                  Realf* targetDataPointer = blockIndexToBlockData[blockK] + j * cell_indices_to_id[1] + gk_mod_WID * cell_indices_to_id[2];
+                  Vec targetData;
+                  targetData.load_a(targetDataPointer);
+                  targetData += target_density_r - target_density_l;                  
+                  targetData.store_a(targetDataPointer);
+               }
+               else
+#endif
+               {
+                  // total value of integrand
+                  const Vec target_density = target_density_r - target_density_l;                  
+#pragma omp simd
+                  for (int target_i=0; target_i < VECL; ++target_i) {
+                     // do the conversion from Realv to Realf here, faster than doing it in accumulation
+                     const Realf tval = target_density[target_i];
+                     const uint tcell = target_cell[target_i];
+                     blockIndexToBlockData[blockK][tcell] += tval;
+                  }  // for-loop over vector elements
+               }
                
-                  //the velocity between which we will integrate to put mass
-                  //in the targe cell. If both v_r and v_l are in same cell
-                  //then v_1,v_2 should be between v_l and v_r.
-                  //v_1 and v_2 normalized to be between 0 and 1 in the cell.
-                  //For vector elements where gk is already larger than needed (lagrangian_gk_r), v_2=v_1=v_r and thus the value is zero.
-                  const Vec v_norm_r = (  min(  max( (gk + 1) * intersection_dk + intersection_min, v_l), v_r) - v_l) * i_dv;
-                  /*shift, old right is new left*/
-                  const Vec target_density_l = target_density_r;
-
-                  // compute right integrand
-                  #ifdef ACC_SEMILAG_PLM
+            } // for loop over target k-indices of current source block
+         } // for-loop over source blocks
+      } //for loop over j index
+      valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL) ;// there are WID3/VECL elements of type Vec per block    
+   } //for loop over columns
+}
+
+/** Signature of the map_1d_column_set variants.*/
+typedef void (*ColumnSetMapper)(SpatialCell*, const uint, const Map1dParameters&, vmesh::GlobalID*,
+                                const std::vector<uint>&, const std::vector<uint>&,
+                                const uint, const uint, std::vector<int>&, std::vector<int>&);
+
+template<int reconstruction>
+static ColumnSetMapper getColumnSetMapper(const uint dimension) {
+   switch (dimension) {
+    case 0:
+      return map_1d_column_set<0,reconstruction>;
+    case 1:
+      return map_1d_column_set<1,reconstruction>;
+    default:
+      return map_1d_column_set<2,reconstruction>;
+   }
+}
+
+/** Select the map_1d_column_set variant of the given dimension and of the
+    reconstruction set with vlasovsolver.accelerationReconstruction.*/
+static ColumnSetMapper getColumnSetMapper(const uint dimension) {
+   switch (Parameters::vlasovAccelerationReconstruction) {
+    case accReconstruction::PLM:
+      return getColumnSetMapper<accReconstruction::PLM>(dimension);
+    case accReconstruction::PPM:
+      return getColumnSetMapper<accReconstruction::PPM>(dimension);
+    default:
+      return getColumnSetMapper<accReconstruction::PQM>(dimension);
+   }
+}
+
+/* 
+   Here we map from the current time step grid, to a target grid which
+   is the lagrangian departure grid (so th grid at timestep +dt,
+   tracked backwards by -dt)
+
+   TODO: parallelize with openMP over block-columns. If one also
+   pre-creates new blocks in a separate loop first (serial operation),
+   then the openmp parallization would scale well (better than over
+   spatial cells), and would not need synchronization.
+   
+*/
+bool map_1d(SpatialCell* spatial_cell,
+            const uint popID,     
+            Realv intersection, Realv intersection_di, Realv intersection_dj,Realv intersection_dk,
+            const uint dimension) {
+   no_subnormals();
+
+   vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh    = spatial_cell->get_velocity_mesh(popID);
+
+   //nothing to do if no blocks
+   if(vmesh.size() == 0)
+      return true;
+
+   Map1dParameters mp;
+   setup_map_1d(vmesh, intersection, intersection_di, intersection_dj, intersection_dk, dimension, mp);
+
+   // sort blocks according to dimension, and divide them into columns
+   Map1dArena& arena = getMap1dArena();
+   arena.blocks.resize(vmesh.size());
+   sortBlocklistByDimension(spatial_cell, popID, dimension, arena.blocks.data(),
+                            arena.columnBlockOffsets, arena.columnNumBlocks,
+                            arena.setColumnOffsets, arena.setNumColumns,
+                            arena.blockPairs);
+   arena.columnMinBlockK.resize(arena.columnNumBlocks.size());
+   arena.columnMaxBlockK.resize(arena.columnNumBlocks.size());
+   
+   // loop over block column sets  (all columns along the dimension with the other dimensions being equal )
+   const ColumnSetMapper mapColumnSet = getColumnSetMapper(dimension);
+   for(uint setIndex=0; setIndex< arena.setColumnOffsets.size(); ++setIndex) {
+      mapColumnSet(spatial_cell, popID, mp, arena.blocks.data(),
+                   arena.columnBlockOffsets, arena.columnNumBlocks,
+                   arena.setColumnOffsets[setIndex], arena.setNumColumns[setIndex],
+                   arena.columnMinBlockK, arena.columnMaxBlockK);
+   }
+   updateMap1dArenaBytes(arena);
+   return true;
+}
+
+/** Dense velocity box used by map_3d_fused. The box covers the blocks
+    [lo, lo + nBlocks[ of the velocity mesh, its values are stored with
+    the vx index running fastest. The vx and vy extents are padded to a
+    multiple of VECL cells, so that VECL adjacent lines can always be
+    loaded into one Vec.*/
+struct VelocityBox {
+   int lo[3];
+   int nBlocks[3];
+   int nCells[3];  /*< padded number of cells, per dimension */
+   size_t stride[3];
+   Realv* data;
+};
+
+/** Extend the box along the given dimension so that it covers the target
+    blocks of the mapping along it. Same estimate as the one used for the
+    target columns in map_1d_column_set, but for the whole box at once.*/
+static void extendVelocityBox(SpatialCell* spatial_cell, const uint popID,
+                              const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                              const uint dimension, const Realv is[4],
+                              int lo[3], int hi[3]) {
+   const uint8_t REFLEVEL = 0;
+   const Realv dv = vmesh.getCellSize(REFLEVEL)[dimension];
+   const Realv v_min = vmesh.getMeshMinLimits()[dimension];
+   const int max_v_length = vmesh.getGridLength(REFLEVEL)[dimension];
+   const Realv intersection_dk = is[1 + dimension];
+
+   // intersection_min is linear in the cell indices of the other two
+   // dimensions, so its extremes are found at the corners of the box
+   Realv max_intersectionMin = std::numeric_limits<Realv>::lowest();
+   Realv min_intersectionMin = std::numeric_limits<Realv>::max();
+   const uint p = (dimension + 1) % 3;
+   const uint q = (dimension + 2) % 3;
+   for (int cp = 0; cp < 2; ++cp) {
+      for (int cq = 0; cq < 2; ++cq) {
+         const Realv gp = cp ? (hi[p] + 1) * WID - 1 : lo[p] * WID;
+         const Realv gq = cq ? (hi[q] + 1) * WID - 1 : lo[q] * WID;
+         const Realv intersectionMin = is[0] + gp * is[1 + p] + gq * is[1 + q];
+         max_intersectionMin = std::max(max_intersectionMin, intersectionMin);
+         min_intersectionMin = std::min(min_intersectionMin, intersectionMin);
+      }
+   }
+
+   const double firstBlockMinV = (WID * lo[dimension]) * dv + v_min;
+   const double lastBlockMaxV = (WID * (hi[dimension] + 1)) * dv + v_min;
+   const int firstBlock_gk = (int)((firstBlockMinV - max_intersectionMin)/intersection_dk);
+   const int lastBlock_gk = (int)((lastBlockMaxV - min_intersectionMin)/intersection_dk);
+
+   const int firstBlockIndexK = std::min(std::max(firstBlock_gk/WID, 0), max_v_length - 1);
+   const int lastBlockIndexK = std::min(std::max(lastBlock_gk/WID, 0), max_v_length - 1);
+   checkVelocitySpaceWallMargin(spatial_cell, popID, firstBlockIndexK, lastBlockIndexK, max_v_length);
+   lo[dimension] = std::min(lo[dimension], firstBlockIndexK);
+   hi[dimension] = std::max(hi[dimension], lastBlockIndexK);
+}
+
+/** Map all lines of the box along the given dimension. VECL adjacent lines
+    are mapped at a time, along vx for the vy and vz mappings and along vy
+    for the vx mapping. The lines are gathered into a column buffer, mapped
+    with the same algorithm as in map_1d_column_set, and the result is
+    written back into the box instead of into the velocity blocks.*/
+template<uint dimension, int reconstruction>
+static void map_box_1d(VelocityBox& box, Map1dArena& arena,
+                       const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                       const Realv is[4], const Realv minValue) {
+   const uint8_t REFLEVEL = 0;
+   constexpr uint p = (dimension == 0) ? 1 : 0; // vectorized dimension
+   constexpr uint q = 3 - dimension - p;
+   const Realv dv = vmesh.getCellSize(REFLEVEL)[dimension];
+   const Realv i_dv = 1.0/dv;
+   const Realv v_min = vmesh.getMeshMinLimits()[dimension];
+   const Realv intersection_dk = is[1 + dimension];
+   const int len = box.nBlocks[dimension] * WID;
+   const int firstGk = box.lo[dimension] * WID;
+
+   arena.boxColumn.assign(len + 2 * WID, Vec(0.0));
+   arena.boxTarget.assign(len, Vec(0.0));
+   Vec* values = arena.boxColumn.data();
+   Vec* target = arena.boxTarget.data();
+
+   Realv laneOffsets[VECL];
+   for (int l = 0; l < VECL; ++l) laneOffsets[l] = l;
+   Vec lanes;
+   lanes.load(laneOffsets);
+
+   for (int cq = 0; cq < box.nBlocks[q] * WID; ++cq) {
+      for (int cp = 0; cp < box.nBlocks[p] * WID; cp += VECL) {
+         Realv* line = box.data + cp * box.stride[p] + cq * box.stride[q];
+
+         // gather the lines, skip them if there is nothing to map
+         bool hasContent = false;
+         for (int g = 0; g < len; ++g) {
+            if constexpr (p == 0) {
+               values[WID + g].load(line + g * box.stride[dimension]);
+            } else {
+               Realv temp[VECL];
+               for (int l = 0; l < VECL; ++l) temp[l] = line[g * box.stride[dimension] + l * box.stride[p]];
+               values[WID + g].load(temp);
+            }
+            hasContent = hasContent || horizontal_or(values[WID + g] != Realv(0.0));
+         }
+         if (!hasContent) continue;
+
+         const Vec intersection_min =
+            is[0] +
+            ((box.lo[p] * WID + cp) + lanes) * is[1 + p] +
+            (Realv)(box.lo[q] * WID + cq) * is[1 + q];
+
+         Vec v_r((WID * box.lo[dimension]) * dv + v_min);
+         Vec lagrangian_v_r((v_r-intersection_min)/intersection_dk);
+#if VECTORCLASS_H >= 20000
+         Veci lagrangian_gk_r=truncatei(lagrangian_v_r);
+#else
+         Veci lagrangian_gk_r=truncate_to_int(lagrangian_v_r);
+#endif
+         int minGkIndex=0, maxGkIndex=0;
+         {
+            Realv maxV = std::numeric_limits<Realv>::lowest();
+            Realv minV = std::numeric_limits<Realv>::max();
+            for(int i = 0; i < VECL; i++) {
+               if ( lagrangian_v_r[i] > maxV) {
+                  maxV = lagrangian_v_r[i];
+                  maxGkIndex = i;
+               }
+               if ( lagrangian_v_r[i] < minV) {
+                  minV = lagrangian_v_r[i];
+                  minGkIndex = i;
+               }
+            }
+         }
+
+         for (int k = 0; k < len; ++k) {
+            Vec a[reconstruction == accReconstruction::PLM ? 2 : reconstruction == accReconstruction::PPM ? 3 : 5];
+            if constexpr (reconstruction == accReconstruction::PLM) {
+               compute_plm_coeff(values, k + WID, a, minValue);
+            }
+            if constexpr (reconstruction == accReconstruction::PPM) {
+               compute_ppm_coeff(values, h4, k + WID, a, minValue);
+            }
+            if constexpr (reconstruction == accReconstruction::PQM) {
+               compute_pqm_coeff(values, h8, k + WID, a, minValue);
+            }
+
+            Vec target_density_r(0.0);
+            Vec v_l = v_r;
+            v_r += dv;
+            const Veci lagrangian_gk_l = lagrangian_gk_r;
+#if VECTORCLASS_H >= 20000
+            lagrangian_gk_r = truncatei((v_r-intersection_min)/intersection_dk);
+#else
+            lagrangian_gk_r = truncate_to_int((v_r-intersection_min)/intersection_dk);
+#endif
+            const int minGk = std::max(int(lagrangian_gk_l[minGkIndex]), firstGk);
+            const int maxGk = std::min(int(lagrangian_gk_r[maxGkIndex]), firstGk + len - 1);
+            for (int gk = minGk; gk <= maxGk; gk++) {
+               const Vec v_norm_r = (  min(  max( (gk + 1) * intersection_dk + intersection_min, v_l), v_r) - v_l) * i_dv;
+               const Vec target_density_l = target_density_r;
+               if constexpr (reconstruction == accReconstruction::PLM) {
                   target_density_r =
                      v_norm_r * ( a[0] + v_norm_r * a[1] );
-                  #endif
-                  #ifdef ACC_SEMILAG_PPM
+               }
+               if constexpr (reconstruction == accReconstruction::PPM) {
                   target_density_r =
                      v_norm_r * ( a[0] + v_norm_r * ( a[1] + v_norm_r * a[2] ) );
-
-                  #endif
-                  #ifdef ACC_SEMILAG_PQM
+               }
+               if constexpr (reconstruction == accReconstruction::PQM) {
                   target_density_r =
                      v_norm_r * ( a[0] + v_norm_r * ( a[1] + v_norm_r * ( a[2] + v_norm_r * ( a[3] + v_norm_r * a[4] ) ) ) );
-                  #endif
-                  
-                  //store values, one element at a time. All blocks
-                  //have been created by now.
-                  //TODO replace by vector version & scatter & gather operation
-                  
-                  
-                  if(dimension == 2) {
-                     Realf* targetDataPointer = blockIndexToBlockData[blockK] + j * cell_indices_to_id[1] + gk_mod_WID * cell_indices_to_id[2];
-                     Vec targetData;
-                     targetData.load_a(targetDataPointer);
-                     targetData += target_density_r - target_density_l;                  
-                     targetData.store_a(targetDataPointer);
-                  }
-                  else{
-                     // total value of integrand
-                     const Vec target_density = target_density_r - target_density_l;                  
-#pragma omp simd
-                     for (int target_i=0; target_i < VECL; ++target_i) {
-                        // do the conversion from Realv to Realf here, faster than doing it in accumulation
-                        const Realf tval = target_density[target_i];
-                        const uint tcell = target_cell[target_i];
-                        blockIndexToBlockData[blockK][tcell] += tval;
-                     }  // for-loop over vector elements
+               }
+               target[gk - firstGk] += target_density_r - target_density_l;
+            }
+         }
+
+         // write the mapped lines back into the box
+         for (int g = 0; g < len; ++g) {
+            if constexpr (p == 0) {
+               target[g].store(line + g * box.stride[dimension]);
+            } else {
+               for (int l = 0; l < VECL; ++l) line[g * box.stride[dimension] + l * box.stride[p]] = target[g][l];
+            }
+            target[g] = Vec(0.0);
+         }
+      }
+   }
+}
+
+/** Signature of the map_box_1d variants.*/
+typedef void (*BoxMapper)(VelocityBox&, Map1dArena&, const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>&,
+                          const Realv*, const Realv);
+
+template<int reconstruction>
+static BoxMapper getBoxMapper(const uint dimension) {
+   switch (dimension) {
+    case 0:
+      return map_box_1d<0,reconstruction>;
+    case 1:
+      return map_box_1d<1,reconstruction>;
+    default:
+      return map_box_1d<2,reconstruction>;
+   }
+}
+
+static BoxMapper getBoxMapper(const uint dimension) {
+   switch (Parameters::vlasovAccelerationReconstruction) {
+    case accReconstruction::PLM:
+      return getBoxMapper<accReconstruction::PLM>(dimension);
+    case accReconstruction::PPM:
+      return getBoxMapper<accReconstruction::PPM>(dimension);
+    default:
+      return getBoxMapper<accReconstruction::PQM>(dimension);
+   }
+}
+
+/*
+   Fused version of three consecutive calls to map_1d. The blocks of the
+   cell are copied once into a dense velocity box that covers both the
+   source blocks and the target blocks of all three mappings, the three
+   mappings are done in the box, and the result is copied back into the
+   block container. Blocks that are left empty are removed and blocks that
+   got content are created, once instead of after each mapping. The velocity
+   blocks are thus read and written once per subcycle instead of three times.
+
+   Empty lines of the box are skipped, so the extra work is bounded by the
+   number of lines, but the box has to fit into memory. If the box would
+   exceed vlasovsolver.accelerationFusedMaxBoxBlocks blocks, or
+   vlasovsolver.accelerationFusedMaxBoxRatio times the number of blocks in
+   the cell, nothing is done and false is returned, and the caller
+   falls back to map_1d.
+
+   dimensions are the dimensions in mapping order, and intersections the
+   intersection, intersection_di, intersection_dj and intersection_dk values
+   of each mapping, in the same order.
+*/
+bool map_3d_fused(SpatialCell* spatial_cell,
+                  const uint popID,
+                  const uint dimensions[3],
+                  const Realv intersections[3][4]) {
+   no_subnormals();
+
+   vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh    = spatial_cell->get_velocity_mesh(popID);
+   vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks(popID);
+   const vmesh::LocalID nBlocks = vmesh.size();
+   if (nBlocks == 0) return true;
+   uint8_t refLevel = 0;
+
+   // bounding box of the source blocks, extended by the target blocks of each mapping
+   int lo[3] = {std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+   int hi[3] = {-1, -1, -1};
+   for (vmesh::LocalID blockLID = 0; blockLID < nBlocks; ++blockLID) {
+      velocity_block_indices_t indices;
+      vmesh.getIndices(vmesh.getGlobalID(blockLID), refLevel, indices[0], indices[1], indices[2]);
+      for (int d = 0; d < 3; ++d) {
+         lo[d] = std::min(lo[d], (int)indices[d]);
+         hi[d] = std::max(hi[d], (int)indices[d]);
+      }
+   }
+   for (int m = 0; m < 3; ++m) {
+      extendVelocityBox(spatial_cell, popID, vmesh, dimensions[m], intersections[m], lo, hi);
+   }
+
+   VelocityBox box;
+   size_t boxBlocks = 1;
+   for (int d = 0; d < 3; ++d) {
+      box.lo[d] = lo[d];
+      box.nBlocks[d] = hi[d] - lo[d] + 1;
+      box.nCells[d] = box.nBlocks[d] * WID;
+      if (d < 2) box.nCells[d] = ((box.nCells[d] + VECL - 1) / VECL) * VECL;
+      boxBlocks *= box.nBlocks[d];
+   }
+   if (boxBlocks > Parameters::vlasovAccelerationFusedMaxBoxBlocks ||
+       boxBlocks > Parameters::vlasovAccelerationFusedMaxBoxRatio * nBlocks) {
+      return false;
+   }
+   box.stride[0] = 1;
+   box.stride[1] = box.nCells[0];
+   box.stride[2] = (size_t)box.nCells[0] * box.nCells[1];
+
+   Map1dArena& arena = getMap1dArena();
+   arena.box.assign(box.stride[2] * box.nCells[2], 0.0);
+   box.data = arena.box.data();
+
+   // copy the blocks into the box
+   for (vmesh::LocalID blockLID = 0; blockLID < nBlocks; ++blockLID) {
+      velocity_block_indices_t indices;
+      vmesh.getIndices(vmesh.getGlobalID(blockLID), refLevel, indices[0], indices[1], indices[2]);
+      const Realf* data = blockContainer.getData(blockLID);
+      Realv* boxData = box.data
+         + (indices[0] - box.lo[0]) * WID * box.stride[0]
+         + (indices[1] - box.lo[1]) * WID * box.stride[1]
+         + (indices[2] - box.lo[2]) * WID * box.stride[2];
+      for (uint k = 0; k < WID; ++k) {
+         for (uint j = 0; j < WID; ++j) {
+            for (uint i = 0; i < WID; ++i) {
+               boxData[i + j * box.stride[1] + k * box.stride[2]] = data[vblock::index(i,j,k)];
+            }
+         }
+      }
+   }
+
+   const Realv minValue = spatial_cell->getVelocityBlockMinValue(popID);
+   for (int m = 0; m < 3; ++m) {
+      getBoxMapper(dimensions[m])(box, arena, vmesh, intersections[m], minValue);
+   }
+
+   // find the blocks that have content after the mapping
+   arena.boxHasContent.assign(boxBlocks, false);
+   for (int bk = 0; bk < box.nBlocks[2]; ++bk) {
+      for (int bj = 0; bj < box.nBlocks[1]; ++bj) {
+         for (int bi = 0; bi < box.nBlocks[0]; ++bi) {
+            const Realv* boxData = box.data + bi * WID * box.stride[0] + bj * WID * box.stride[1] + bk * WID * box.stride[2];
+            bool hasContent = false;
+            for (uint k = 0; k < WID; ++k) {
+               for (uint j = 0; j < WID; ++j) {
+                  for (uint i = 0; i < WID; ++i) {
+                     hasContent = hasContent || boxData[i + j * box.stride[1] + k * box.stride[2]] != 0.0;
                   }
-                  
-               } // for loop over target k-indices of current source block
-            } // for-loop over source blocks
-         } //for loop over j index
-         valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL) ;// there are WID3/VECL elements of type Vec per block    
-      } //for loop over columns
-      
+               }
+            }
+            arena.boxHasContent[bi + box.nBlocks[0] * (bj + box.nBlocks[1] * bk)] = hasContent;
+         }
+      }
+   }
+
+   // remove blocks that were emptied and add the ones that got content
+   arena.blocks.resize(nBlocks);
+   for (vmesh::LocalID blockLID = 0; blockLID < nBlocks; ++blockLID) {
+      arena.blocks[blockLID] = vmesh.getGlobalID(blockLID);
+   }
+   for (const vmesh::GlobalID blockGID : arena.blocks) {
+      velocity_block_indices_t indices;
+      vmesh.getIndices(blockGID, refLevel, indices[0], indices[1], indices[2]);
+      const size_t boxIndex = (indices[0] - box.lo[0]) + box.nBlocks[0] * ((indices[1] - box.lo[1]) + box.nBlocks[1] * (indices[2] - box.lo[2]));
+      if (arena.boxHasContent[boxIndex]) {
+         arena.boxHasContent[boxIndex] = false; // exists already
+      } else {
+         spatial_cell->remove_velocity_block(blockGID, popID);
+      }
    }
-   delete [] blocks;
+   arena.blocks.clear();
+   for (int bk = 0; bk < box.nBlocks[2]; ++bk) {
+      for (int bj = 0; bj < box.nBlocks[1]; ++bj) {
+         for (int bi = 0; bi < box.nBlocks[0]; ++bi) {
+            if (arena.boxHasContent[bi + box.nBlocks[0] * (bj + box.nBlocks[1] * bk)]) {
+               arena.blocks.push_back(vmesh.getGlobalID(refLevel, box.lo[0] + bi, box.lo[1] + bj, box.lo[2] + bk));
+            }
+         }
+      }
+   }
+   if (arena.blocks.size() > 0) {
+      spatial_cell->add_velocity_blocks(arena.blocks, popID);
+   }
+
+   // copy the box back into the blocks
+   for (vmesh::LocalID blockLID = 0; blockLID < vmesh.size(); ++blockLID) {
+      velocity_block_indices_t indices;
+      vmesh.getIndices(vmesh.getGlobalID(blockLID), refLevel, indices[0], indices[1], indices[2]);
+      Realf* data = blockContainer.getData(blockLID);
+      const Realv* boxData = box.data
+         + (indices[0] - box.lo[0]) * WID * box.stride[0]
+         + (indices[1] - box.lo[1]) * WID * box.stride[1]
+         + (indices[2] - box.lo[2]) * WID * box.stride[2];
+      for (uint k = 0; k < WID; ++k) {
+         for (uint j = 0; j < WID; ++j) {
+            for (uint i = 0; i < WID; ++i) {
+               data[vblock::index(i,j,k)] = boxData[i + j * box.stride[1] + k * box.stride[2]];
+            }
+         }
+      }
+   }
+   updateMap1dArenaBytes(arena);
    return true;
 }
-
@@ -33,4 +33,12 @@ bool map_1d(SpatialCell* spatial_cell, const uint popID,
             Realv intersection, Realv intersection_di, Realv intersection_dj,Realv intersection_dk,
             const uint dimension) ;
 
+bool map_3d_fused(SpatialCell* spatial_cell, const uint popID,
+                  const uint dimensions[3],
+                  const Realv intersections[3][4]);
+
+/** Get the number of bytes currently held by the per-thread scratch
+    arenas of map_1d and map_3d_fused, summed over all threads.*/
+size_t getMap1dArenaBytes();
+
 #endif
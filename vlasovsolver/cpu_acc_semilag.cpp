@@ -64,6 +64,62 @@ uint getAccelerationSubcycles(SpatialCell* spatial_cell, Real dt, const uint pop
    return max( convert<uint>(ceil(dt / spatial_cell->get_max_v_dt(popID))), 1u);
 }
 
+/*!
+  Check if the acceleration of the particle species in the spatial cell can
+  be skipped. This is the case when the acceleration transform over dt is a
+  rotation around the bulk velocity of the population, and the distribution
+  is isotropic around the bulk velocity so that the rotation does not change
+  it, e.g., a cold population gyrating in a magnetic field without an electric
+  field in its rest frame. Isotropy is measured from the pressure tensor, the
+  product of the anisotropy |P - p I| / p and the rotation angle may not exceed
+  P::vlasovAccelerationSkipAnisotropy, and the bulk velocity may not move by
+  more than P::vlasovAccelerationSkipShift velocity cells. Requires up to date
+  _V moments, as the transform itself does.
+
+ * @param spatial_cell Spatial cell containing the accelerated population.
+ * @param popID ID of the accelerated particle species.
+ * @param dt Time step of the whole acceleration.
+ * @return If true, the population does not need to be accelerated.
+*/
+
+bool canSkipAcceleration(SpatialCell* spatial_cell, const uint popID, const Real& dt) {
+   const Population& pop = spatial_cell->get_population(popID);
+   if (pop.RHO_V <= 0.0) return false;
+   const Eigen::Matrix<Real,3,1> bulk_velocity(pop.V_V[0],pop.V_V[1],pop.V_V[2]);
+
+   const Transform<Real,3,Affine> fwd_transform = compute_acceleration_transformation(spatial_cell,popID,dt);
+
+   // The bulk velocity has to stay in place
+   const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = spatial_cell->get_velocity_mesh(popID);
+   const Real* dv = vmesh.getCellSize(0);
+   const Real maxShift = P::vlasovAccelerationSkipShift * min(dv[0],min(dv[1],dv[2]));
+   if ((fwd_transform*bulk_velocity - bulk_velocity).norm() > maxShift) return false;
+
+   const Real angle = fabs(AngleAxis<Real>(fwd_transform.linear()).angle());
+   if (angle == 0.0) return true;
+
+   // Pressure tensor around the bulk velocity, in units of the particle mass
+   const vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks(popID);
+   const Realf* data = blockContainer.getData();
+   const Real* blockParams = blockContainer.getParameters();
+   Eigen::Matrix<Real,3,3> pressure = Eigen::Matrix<Real,3,3>::Zero();
+   for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+      const Realf* avgs = data + blockLID*WID3;
+      const Real* parameters = blockParams + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      const Real cellVolume = parameters[BlockParams::DVX]*parameters[BlockParams::DVY]*parameters[BlockParams::DVZ];
+      for (uint k=0; k<WID; ++k) for (uint j=0; j<WID; ++j) for (uint i=0; i<WID; ++i) {
+         const Eigen::Matrix<Real,3,1> v(parameters[BlockParams::VXCRD] + (i+0.5)*parameters[BlockParams::DVX] - bulk_velocity[0],
+                                         parameters[BlockParams::VYCRD] + (j+0.5)*parameters[BlockParams::DVY] - bulk_velocity[1],
+                                         parameters[BlockParams::VZCRD] + (k+0.5)*parameters[BlockParams::DVZ] - bulk_velocity[2]);
+         pressure += (avgs[cellIndex(i,j,k)]*cellVolume) * (v*v.transpose());
+      }
+   }
+   const Real scalarPressure = pressure.trace() / 3.0;
+   if (scalarPressure <= 0.0) return true;
+   const Real anisotropy = (pressure - scalarPressure*Eigen::Matrix<Real,3,3>::Identity()).norm() / scalarPressure;
+   return anisotropy*angle <= P::vlasovAccelerationSkipAnisotropy;
+}
+
 /*!
   Propagates the distribution function in velocity space of given real
   space cell.
@@ -85,8 +141,6 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
                          const uint popID,     
                          const uint map_order,
                          const Real& dt) {
-   //double t1 = MPI_Wtime();
-
    vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh    = spatial_cell->get_velocity_mesh(popID);
    //vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks(popID);
 
@@ -102,48 +156,31 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
    Real intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk;
    Real intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk;
    Real intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk;
-   int intersections_id {phiprof::initializeTimer("compute-intersections")};
-   int mapping_id {phiprof::initializeTimer("compute-mapping")};
+   phiprof::Timer intersectionsTimer {"compute-intersections"};
    switch(map_order){
       case 0: {
          //Map order XYZ
-         phiprof::Timer intersectionsTimer {intersections_id};
          compute_intersections_1st(vmesh,bwd_transform, fwd_transform, 0, refLevel,
                                    intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk);
          compute_intersections_2nd(vmesh,bwd_transform, fwd_transform, 1, refLevel,
                                    intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk);
          compute_intersections_3rd(vmesh,bwd_transform, fwd_transform, 2, refLevel,
                                    intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk);
-         intersectionsTimer.stop();
-         phiprof::Timer mappingTimer {mapping_id};
-         map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
-         map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
-         map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
-         mappingTimer.stop();
          break;
       }
          
       case 1: {
          //Map order YZX
-         phiprof::Timer intersectionsTimer{intersections_id};
          compute_intersections_1st(vmesh, bwd_transform, fwd_transform, 1, refLevel,
                                    intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk);
          compute_intersections_2nd(vmesh, bwd_transform, fwd_transform, 2, refLevel,
                                    intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk);
          compute_intersections_3rd(vmesh, bwd_transform, fwd_transform, 0, refLevel,
                                    intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk);
-      
-         intersectionsTimer.stop();
-         phiprof::Timer mappingTimer {mapping_id};
-         map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
-         map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
-         map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
-         mappingTimer.stop();
          break;
       }
 
       case 2: {
-         phiprof::Timer intersectionsTimer{intersections_id};
          //Map order Z X Y
          compute_intersections_1st(vmesh, bwd_transform, fwd_transform, 2, refLevel,
                                    intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk);
@@ -151,17 +188,29 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
                                    intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk);
          compute_intersections_3rd(vmesh, bwd_transform, fwd_transform, 1, refLevel,
                                    intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk);
-         intersectionsTimer.stop();
-         phiprof::Timer mappingTimer {mapping_id};
-         map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
-         map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
-         map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
-         mappingTimer.stop();
          break;
       }
    }
+   intersectionsTimer.stop();
+
+   // Dimensions of the 1st, 2nd and 3rd mapping for each map order (XYZ, YZX, ZXY)
+   const uint mapDimensions[3][3] = {{0,1,2}, {1,2,0}, {2,0,1}};
+   const uint* dims = mapDimensions[map_order];
+   const Realv intersectionsOfDimension[3][4] = {
+      {(Realv)intersection_x,(Realv)intersection_x_di,(Realv)intersection_x_dj,(Realv)intersection_x_dk},
+      {(Realv)intersection_y,(Realv)intersection_y_di,(Realv)intersection_y_dj,(Realv)intersection_y_dk},
+      {(Realv)intersection_z,(Realv)intersection_z_di,(Realv)intersection_z_dj,(Realv)intersection_z_dk}};
+   Realv intersections[3][4];
+   for (int m=0; m<3; ++m) {
+      for (int i=0; i<4; ++i) intersections[m][i] = intersectionsOfDimension[dims[m]][i];
+   }
 
-   if (Parameters::prepareForRebalance == true) {
-//       spatial_cell->parameters[CellParams::LBWEIGHTCOUNTER] += (MPI_Wtime() - t1);
+   phiprof::Timer mappingTimer {"compute-mapping"};
+   // The fused mapping returns false if the cell does not fit into its velocity box
+   if (!(Parameters::vlasovAccelerationFused && map_3d_fused(spatial_cell, popID, dims, intersections))) {
+      for (int m=0; m<3; ++m) {
+         map_1d(spatial_cell, popID, intersections[m][0],intersections[m][1],intersections[m][2],intersections[m][3],dims[m]);
+      }
    }
+   mappingTimer.stop();
 }
@@ -28,6 +28,7 @@
 
 void prepareAccelerateCell(spatial_cell::SpatialCell* spatial_cell, const uint popID);
 uint getAccelerationSubcycles(spatial_cell::SpatialCell* spatial_cell, Real dt, const uint popID);
+bool canSkipAcceleration(spatial_cell::SpatialCell* spatial_cell, const uint popID, const Real& dt);
 
 
 
@@ -37,92 +37,31 @@ inline bool paircomparator( const std::pair<uint, uint> & l, const std::pair<uin
 }
 
 /*
-   This function returns a sorted list of blocks in a cell.
+   Divide the sorted (sort key, global ID) pairs into columns along the
+   given dimension, and copy the global IDs in sorted order into blocks.
 
-   The sorted list is sorted according to the location, along the given dimension.
-   
+   The column and column set vectors are appended to, so that the column
+   structures of several cells can be gathered into the same vectors. Column
+   offsets are relative to the given blocks array, column set offsets are
+   indices into the (appended) column vectors.
 */
-#warning "unfinished documentation"
-void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
-                               const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
-                               const uint dimension,
-                               uint* blocks,
-                               std::vector<uint> & columnBlockOffsets,
-                               std::vector<uint> & columnNumBlocks,
-                               std::vector<uint> & setColumnOffsets,
-                               std::vector<uint> & setNumColumns) {
-   //const uint nBlocks = spatial_cell->get_number_of_velocity_blocks(); // Number of blocks
-   const vmesh::LocalID nBlocks = vmesh.size();
+static void buildBlockColumns(const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                              const uint dimension,
+                              const std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs,
+                              uint* blocks,
+                              std::vector<uint> & columnBlockOffsets,
+                              std::vector<uint> & columnNumBlocks,
+                              std::vector<uint> & setColumnOffsets,
+                              std::vector<uint> & setNumColumns) {
+   const vmesh::LocalID nBlocks = block_pairs.size();
 
    // Velocity mesh refinement level, has no effect here
    // but is needed in some vmesh::VelocityMesh function calls.
    const uint8_t REFLEVEL = 0;
-   
-   // Copy block data to vector
-   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > block_pairs;
-   block_pairs.resize( nBlocks );
-   for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
-      //const vmesh::GlobalID block = spatial_cell->get_velocity_block_global_id(i);
-      const vmesh::GlobalID block = vmesh.getGlobalID(i);
-      switch( dimension ) {
-       case 0: {
-          const vmesh::GlobalID blockId_mapped = block; // Mapping the block id to different coordinate system if dimension is not zero:
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
-         break;
-       case 1: {
-          // Do operation: 
-          //   block = x + y*x_max + z*y_max*x_max 
-          //=> block' = block - (x + y*x_max) + y + x*y_max = x + y*x_max + z*y_max*x_max - (x + y*x_max) + y + x*y_max
-          //          = y + x*y_max + z*y_max*x_max
-          //const uint x_indice = block%SpatialCell::get_velocity_grid_length()[0];
-          //const uint y_indice = (block/SpatialCell::get_velocity_grid_length()[0])%SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          const vmesh::LocalID x_index = block % vmesh.getGridLength(REFLEVEL)[0];
-          const vmesh::LocalID y_index = (block / vmesh.getGridLength(REFLEVEL)[0]) % vmesh.getGridLength(REFLEVEL)[1];
-
-          // Mapping the block id to different coordinate system if dimension is not zero:
-          //const uint blockId_mapped 
-          //        = block - (x_indice + y_indice*SpatialCell::get_velocity_grid_length()[0]) 
-          //        + y_indice 
-          //        + x_indice * SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          const vmesh::GlobalID blockId_mapped 
-                  = block - (x_index + y_index*vmesh.getGridLength(REFLEVEL)[0])
-                  + y_index 
-                  + x_index * vmesh.getGridLength(REFLEVEL)[1];
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
-         break;
-       case 2: {
-          // Do operation: 
-          //   block = x + y*x_max + z*y_max*x_max 
-          //=> block' = z + y*z_max + x*z_max*y_max
-          //const uint x_indice = block%SpatialCell::get_velocity_grid_length()[0];
-          //const uint y_indice = (block/SpatialCell::get_velocity_grid_length()[0])%SpatialCell::SpatialCell::get_velocity_grid_length()[1];
-          //const uint z_indice =  (block/(SpatialCell::get_velocity_grid_length()[0]*SpatialCell::SpatialCell::get_velocity_grid_length()[1]));
-          const vmesh::LocalID x_index = block % vmesh.getGridLength(REFLEVEL)[0];
-          const vmesh::LocalID y_index = (block / vmesh.getGridLength(REFLEVEL)[0]) % vmesh.getGridLength(REFLEVEL)[1];
-          const vmesh::LocalID z_index = (block / (vmesh.getGridLength(REFLEVEL)[0]*vmesh.getGridLength(REFLEVEL)[1]));
-
-          // Mapping the block id to different coordinate system if dimension is not zero:
-          //const uint blockId_mapped 
-          //  = z_indice 
-          //  + y_indice * SpatialCell::SpatialCell::get_velocity_grid_length()[2] 
-          //  + x_indice*SpatialCell::SpatialCell::get_velocity_grid_length()[1]*SpatialCell::SpatialCell::get_velocity_grid_length()[2];
-          const vmesh::GlobalID blockId_mapped 
-            = z_index 
-            + y_index*vmesh.getGridLength(REFLEVEL)[2]
-            + x_index*vmesh.getGridLength(REFLEVEL)[1]*vmesh.getGridLength(REFLEVEL)[2];
-          block_pairs[i] = std::make_pair( blockId_mapped, block );
-       }
-         break;
-      }
-   }
-   // Sort the list:
-   std::sort( block_pairs.begin(), block_pairs.end(), paircomparator );
 
    // Put in the sorted blocks, and also compute column offsets and lengths:
+   setColumnOffsets.push_back(columnBlockOffsets.size()); //first offset
    columnBlockOffsets.push_back(0); //first offset
-   setColumnOffsets.push_back(0); //first offset   
    uint prev_column_id, prev_dimension_id;
 
    for (vmesh::LocalID i=0; i<nBlocks; ++i) {
@@ -157,3 +96,75 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
    columnNumBlocks.push_back(nBlocks - columnBlockOffsets[columnBlockOffsets.size()-1]);
    setNumColumns.push_back(columnNumBlocks.size() - setColumnOffsets[setColumnOffsets.size()-1]);
 }
+
+/*
+   This function returns a sorted list of blocks in a cell.
+
+   The sorted list is sorted according to the location, along the given dimension.
+
+   The column and column set vectors are appended to, so that the column
+   structures of several cells can be gathered into the same vectors. Column
+   offsets are relative to the given blocks array, column set offsets are
+   indices into the (appended) column vectors.
+
+   block_pairs is scratch space used for sorting. Its contents are
+   overwritten, it is passed in so that callers can reuse its storage.
+   
+*/
+#warning "unfinished documentation"
+void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
+                               const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                               const uint dimension,
+                               uint* blocks,
+                               std::vector<uint> & columnBlockOffsets,
+                               std::vector<uint> & columnNumBlocks,
+                               std::vector<uint> & setColumnOffsets,
+                               std::vector<uint> & setNumColumns,
+                               std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs) {
+   //const uint nBlocks = spatial_cell->get_number_of_velocity_blocks(); // Number of blocks
+   const vmesh::LocalID nBlocks = vmesh.size();
+
+   // Copy block data to vector, mapping the block id to a coordinate
+   // system where the given dimension runs fastest
+   block_pairs.resize( nBlocks );
+   for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
+      const vmesh::GlobalID block = vmesh.getGlobalID(i);
+      const vmesh::GlobalID blockId_mapped = vmesh::VelocityBlockSortIndex<vmesh::GlobalID,vmesh::LocalID>::sortKey(vmesh, dimension, block);
+      block_pairs[i] = std::make_pair( blockId_mapped, block );
+   }
+   // Sort the list:
+   std::sort( block_pairs.begin(), block_pairs.end(), paircomparator );
+
+   buildBlockColumns(vmesh, dimension, block_pairs, blocks,
+                     columnBlockOffsets, columnNumBlocks, setColumnOffsets, setNumColumns);
+}
+
+/*
+   As above, but for the given population of a spatial cell. If
+   vlasovsolver.accelerationSortIndex is enabled the sorted list is taken
+   from the persistent sort index of the population, which is patched
+   with the blocks added or removed since its last use instead of being
+   sorted again.
+*/
+void sortBlocklistByDimension(SpatialCell* spatial_cell,
+                              const uint popID,
+                              const uint dimension,
+                              uint* blocks,
+                              std::vector<uint> & columnBlockOffsets,
+                              std::vector<uint> & columnNumBlocks,
+                              std::vector<uint> & setColumnOffsets,
+                              std::vector<uint> & setNumColumns,
+                              std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs) {
+   const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = spatial_cell->get_velocity_mesh(popID);
+   if (Parameters::vlasovAccelerationSortIndex == false) {
+      sortBlocklistByDimension(vmesh, dimension, blocks,
+                               columnBlockOffsets, columnNumBlocks, setColumnOffsets, setNumColumns,
+                               block_pairs);
+      return;
+   }
+
+   const std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & sorted_pairs
+      = spatial_cell->get_velocity_block_sort_index(popID).getSorted(vmesh, dimension);
+   buildBlockColumns(vmesh, dimension, sorted_pairs, blocks,
+                     columnBlockOffsets, columnNumBlocks, setColumnOffsets, setNumColumns);
+}
@@ -24,6 +24,7 @@
 #ifndef CPU_SORT_BLOCKS_FOR_ACC_H
 #define CPU_SORT_BLOCKS_FOR_ACC_H
 
+#include <utility>
 #include <vector>
 
 #include "../common.h"
@@ -36,6 +37,17 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
                                std::vector<uint> & columnBlockOffsets,
                                std::vector<uint> & columnNumBlocks,
                                std::vector<uint> & setColumnOffsets,
-                               std::vector<uint> & setNumColumns);
+                               std::vector<uint> & setNumColumns,
+                               std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs);
+
+void sortBlocklistByDimension(spatial_cell::SpatialCell* spatial_cell,
+                              const uint popID,
+                              const uint dimension,
+                              uint* blocks,
+                              std::vector<uint> & columnBlockOffsets,
+                              std::vector<uint> & columnNumBlocks,
+                              std::vector<uint> & setColumnOffsets,
+                              std::vector<uint> & setNumColumns,
+                              std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs);
 
 #endif
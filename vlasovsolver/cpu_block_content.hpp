@@ -0,0 +1,96 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef CPU_BLOCK_CONTENT_H
+#define CPU_BLOCK_CONTENT_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "../common.h"
+#include "vec.h"
+
+/* Vectorised scans of the values of a velocity block, used to classify
+ * blocks against the sparsity threshold and to find the maximum of the
+ * distribution function. The block is read VECL values at a time, WID3 is a
+ * multiple of VECL for all vector lengths. With mixed precision (single
+ * precision blocks, double precision Vec) the conversion costs more than the
+ * vectorisation gains, there the scans are plain loops over the block that
+ * the compiler vectorises in single precision.
+ */
+
+/** Threshold in the precision of Vec, so that value >= vectorThreshold(threshold)
+ * in Vec gives the same result as value >= threshold in Real for every value
+ * of the block.
+ * @param threshold Sparsity threshold, e.g. SpatialCell::getVelocityBlockMinValue
+ */
+inline Realv vectorThreshold(const Real threshold) {
+   Realv t = (Realv)threshold;
+   if ((Real)t < threshold) t = std::nextafter(t, std::numeric_limits<Realv>::infinity());
+   return t;
+}
+
+/** Returns true if any value of the block is at least the threshold. The scan
+ * stops at the first vector with such a value.
+ * @param data Values of the block
+ * @param threshold Threshold from vectorThreshold
+ */
+inline bool blockHasContent(const Realf* __restrict__ data, const Realv threshold) {
+#ifdef VEC_MIXED_PRECISION
+   for (uint i = 0; i < WID3; ++i) {
+      if (data[i] >= threshold) return true;
+   }
+#else
+   const Vec thresholdV(threshold);
+   for (uint i = 0; i < WID3; i += VECL) {
+      Vec values;
+      values.load(data + i);
+      if (horizontal_or(values >= thresholdV)) return true;
+   }
+#endif
+   return false;
+}
+
+/** Returns the maximum value of the block, a block has content if its
+ * maximum is at least the sparsity threshold. The whole block is always read,
+ * with one vector max per VECL values and no branches.
+ * @param data Values of the block
+ */
+inline Realv blockMaxValue(const Realf* __restrict__ data) {
+#ifdef VEC_MIXED_PRECISION
+   Realf maxValue = data[0];
+   for (uint i = 1; i < WID3; ++i) maxValue = std::max(maxValue, data[i]);
+   return maxValue;
+#else
+   Vec maxV;
+   maxV.load(data);
+   for (uint i = VECL; i < WID3; i += VECL) {
+      Vec values;
+      values.load(data + i);
+      maxV = max(maxV, values);
+   }
+   Realv maxValue = maxV[0];
+   for (int i = 1; i < VECL; ++i) maxValue = std::max(maxValue, (Realv)maxV[i]);
+   return maxValue;
+#endif
+}
+
+#endif
@@ -309,6 +309,76 @@ void copy_trans_block_data(
    }
 }
 
+/* Get the sorted union of the velocity blocks of the given cells. The global
+   IDs of the velocity mesh are bounded and dense, so each thread marks the
+   blocks of its cells in a bitmap of the whole mesh. The bitmaps are then
+   merged word by word, each thread merging and reading out the set bits of
+   its own range of words, which yields the global IDs in ascending order.
+
+ * @param cells Spatial cells, all with the same velocity mesh.
+ * @param popID ID of the particle species.
+ * @param unionOfBlocks Sorted global IDs of the blocks existing in any of the cells.
+*/
+void get_union_of_blocks(const std::vector<SpatialCell*>& cells,
+                         const uint popID,
+                         std::vector<vmesh::GlobalID>& unionOfBlocks) {
+   unionOfBlocks.clear();
+   if (cells.size() == 0) return;
+
+   const size_t nWords = (cells[0]->get_velocity_mesh(popID).getMaxVelocityBlocks() + 63) / 64;
+   std::vector<std::vector<uint64_t>> threadBitmaps(omp_get_max_threads());
+   std::vector<size_t> threadOffsets(omp_get_max_threads() + 1, 0);
+
+#pragma omp parallel
+   {
+      const int thread = omp_get_thread_num();
+      const int nThreads = omp_get_num_threads();
+      std::vector<uint64_t>& bitmap = threadBitmaps[thread];
+      bitmap.assign(nWords, 0);
+
+#pragma omp for schedule(dynamic,1)
+      for (size_t celli=0; celli<cells.size(); ++celli) {
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cells[celli]->get_velocity_mesh(popID);
+         for (vmesh::LocalID block_i=0; block_i<vmesh.size(); ++block_i) {
+            const vmesh::GlobalID blockGID = vmesh.getGlobalID(block_i);
+            bitmap[blockGID / 64] |= (uint64_t)1 << (blockGID % 64);
+         }
+      }
+
+      // Merge this thread's range of words into the first bitmap and count the blocks in it
+      const size_t wordBegin = nWords * thread / nThreads;
+      const size_t wordEnd = nWords * (thread + 1) / nThreads;
+      size_t nBlocks = 0;
+      for (size_t w=wordBegin; w<wordEnd; ++w) {
+         uint64_t word = 0;
+         for (int t=0; t<nThreads; ++t) {
+            word |= threadBitmaps[t][w];
+         }
+         threadBitmaps[0][w] = word;
+         nBlocks += __builtin_popcountll(word);
+      }
+      threadOffsets[thread + 1] = nBlocks;
+
+#pragma omp barrier
+#pragma omp single
+      {
+         for (int t=0; t<nThreads; ++t) {
+            threadOffsets[t + 1] += threadOffsets[t];
+         }
+         unionOfBlocks.resize(threadOffsets[nThreads]);
+      }
+
+      size_t n = threadOffsets[thread];
+      for (size_t w=wordBegin; w<wordEnd; ++w) {
+         uint64_t word = threadBitmaps[0][w];
+         while (word != 0) {
+            unionOfBlocks[n++] = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+         }
+      }
+   }
+}
+
 /* 
    Here we map from the current time step grid, to a target grid which
    is the lagrangian departure grid (so th grid at timestep +dt,
@@ -360,25 +430,9 @@ bool trans_map_1d(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
    
     
    //Get a unique sorted list of blockids that are in any of the
-   // propagated cells. First use set for this, then add to vector (may not
-   // be the most nice way to do this and in any case we could do it along
-   // dimension for data locality reasons => copy acc map column code, TODO: FIXME
-   std::unordered_set<vmesh::GlobalID> unionOfBlocksSet;
-   
-
-
-   for(uint celli = 0; celli < allCellsPointer.size(); celli++) {
-      vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = allCellsPointer[celli]->get_velocity_mesh(popID);
-      for (vmesh::LocalID block_i=0; block_i< vmesh.size(); ++block_i) {
-         unionOfBlocksSet.insert(vmesh.getGlobalID(block_i));
-      }
-   }
-   
+   // propagated cells.
    std::vector<vmesh::GlobalID> unionOfBlocks;
-   unionOfBlocks.reserve(unionOfBlocksSet.size());
-   for(const auto blockGID:  unionOfBlocksSet) {
-      unionOfBlocks.push_back(blockGID);
-   }
+   get_union_of_blocks(allCellsPointer, popID, unionOfBlocks);
    
     
 
@@ -44,6 +44,8 @@ void store_trans_block_data(SpatialCell** target_neighbors,const vmesh::GlobalID
                             Vec* __restrict__ target_values,
                             const unsigned char* const cellid_transpose,const uint popID);
 
+void get_union_of_blocks(const std::vector<SpatialCell*>& cells,const uint popID,
+                         std::vector<vmesh::GlobalID>& unionOfBlocks);
 bool do_translate_cell(spatial_cell::SpatialCell* SC);
 bool trans_map_1d(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                   const std::vector<CellID>& localPropagatedCells,
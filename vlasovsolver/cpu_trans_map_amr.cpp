@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 #include "cpu_1d_ppm_nonuniform.hpp"
 //#include "cpu_1d_ppm_nonuniform_conserving.hpp"
 #include "vec.h"
@@ -27,6 +30,9 @@ using namespace spatial_cell;
 
 #define i_trans_ps_blockv_pencil(planeVectorIndex, planeIndex, blockIndex, lengthOfPencil) ( (blockIndex) + VLASOV_STENCIL_WIDTH  +  ( (planeVectorIndex) + (planeIndex) * VEC_PER_PLANE ) * ( lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH) )
 
+// A plane of a block is stored in whole vectors, so all lanes carry data
+static_assert(WID2 % VECL == 0 && VEC_PER_PLANE * VECL == WID2, "A block plane has to consist of whole vectors");
+
 
 /* Get the one-dimensional neighborhood index for a given direction and neighborhood size.
  * 
@@ -493,10 +499,10 @@ CellID selectNeighbor(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>
  *             The pencil will continue in the + direction in the given dimension until an end condition is met
  * @param [in] dimension Spatial dimension
  * @param [in] path Integer value that determines which neighbor is added to the pencil when a higher refinement level is met
- * @param [in] endIds Prescribed end conditions for the pencil. If any of these cell ids is about to be added to the pencil,
- *             the builder terminates.
+ * @param [in] endIds Prescribed end conditions for the pencil, sorted in ascending order. If any of these cell ids
+ *             is about to be added to the pencil, the builder terminates.
  */
-setOfPencils buildPencilsWithNeighbors( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry> &grid, 
+void buildPencilsWithNeighbors( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry> &grid, 
 					setOfPencils &pencils, const CellID seedId,
 					vector<CellID> ids, const uint dimension, 
 					vector<uint> path, const vector<CellID> &endIds) {
@@ -653,7 +659,7 @@ setOfPencils buildPencilsWithNeighbors( const dccrg::Dccrg<SpatialCell,dccrg::Ca
             std::cout << " Next neighbor is " << nextNeighbor << "." << std::endl;
          }
 
-         if ( std::any_of(endIds.begin(), endIds.end(), [nextNeighbor](uint i){return i == nextNeighbor;}) ||
+         if ( std::binary_search(endIds.begin(), endIds.end(), nextNeighbor) ||
               !do_translate_cell(grid[nextNeighbor])) {
             
             nextNeighbor = INVALID_CELLID;
@@ -690,10 +696,6 @@ setOfPencils buildPencilsWithNeighbors( const dccrg::Dccrg<SpatialCell,dccrg::Ca
    y = coordinates[iy];
 
    pencils.addPencil(ids,x,y,periodic,path);
-   
-   // TODO why do we have both return value and the argument modified in place? Could be made consistent.
-   return pencils;
-  
 }
 
 bool check_skip_remapping(Vec* values) {
@@ -711,9 +713,11 @@ bool check_skip_remapping(Vec* values) {
  * @param dt Time step
  * @param vmesh Velocity mesh object
  * @param lengthOfPencil Number of cells in the pencil
+ * @param occupied Occupancy mask of the block in the padded source cells, see copy_trans_block_data_amr
+ * @return Number of cells of the pencil that were skipped because their stencil is empty
  */
-void propagatePencil(
-   Vec* dz,
+uint propagatePencil(
+   const Vec* dz,
    Vec* values,
    Vec* targetValues, // thread-owned aligned-allocated
    const uint dimension,
@@ -721,7 +725,8 @@ void propagatePencil(
    const Realv dt,
    const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID> &vmesh,
    const uint lengthOfPencil,
-   const Realv threshold
+   const Realv threshold,
+   const uint8_t* occupied
 ) {
    // Get velocity data from vmesh that we need later to calculate the translation
    velocity_block_indices_t block_indices;
@@ -743,12 +748,36 @@ void propagatePencil(
       
    }
    
+   uint skippedCells = 0;
+   // Number of occupied source cells in the stencil of cell i, which spans
+   // source cells i ... i + 2 * VLASOV_STENCIL_WIDTH
+   uint occupiedStencil = 0;
+   for (uint b = 0; b < 2 * VLASOV_STENCIL_WIDTH; b++) {
+      occupiedStencil += occupied[b];
+   }
+
    // Go from 0 to length here to propagate all the cells in the pencil
    for (uint i = 0; i < lengthOfPencil; i++){
       
       // The source array is padded by VLASOV_STENCIL_WIDTH on both sides.
       uint i_source   = i + VLASOV_STENCIL_WIDTH;
+
+      // Slide the stencil window, a cell whose whole stencil is empty
+      // does not move any density
+      occupiedStencil += occupied[i + 2 * VLASOV_STENCIL_WIDTH];
+      if (i > 0) {
+         occupiedStencil -= occupied[i - 1];
+      }
+      if (occupiedStencil == 0) {
+         skippedCells++;
+         continue;
+      }
       
+      // Scaling of the density moved into the neighbors by the ratio of the cell
+      // sizes, the same for all vectors of the block
+      const Vec dzRatioNext = dz[i_source] / dz[i_source + 1];
+      const Vec dzRatioPrevious = dz[i_source] / dz[i_source - 1];
+
       for (uint k = 0; k < WID; ++k) {
 
          const Realv cell_vz = (block_indices[dimension] * WID + k + 0.5) * dvz + vz_min; //cell centered velocity
@@ -795,12 +824,10 @@ void propagatePencil(
             // Store mapped density in two target cells
             // in the neighbor cell we will put this density
             targetValues[i_trans_pt_blockv(planeVector, k, i + 1)] += select( positiveTranslationDirection,
-                                                                              ngbr_target_density
-                                                                              * dz[i_source] / dz[i_source + 1],
+                                                                              ngbr_target_density * dzRatioNext,
                                                                               Vec(0.0));
             targetValues[i_trans_pt_blockv(planeVector, k, i - 1 )] += select(!positiveTranslationDirection,
-                                                                              ngbr_target_density
-                                                                              * dz[i_source] / dz[i_source - 1],
+                                                                              ngbr_target_density * dzRatioPrevious,
                                                                               Vec(0.0));
             
             // in the current original cells we will put the rest of the original density
@@ -809,6 +836,7 @@ void propagatePencil(
          }
       }
    }
+   return skippedCells;
 }
 
 /* Determine which cells in the local DCCRG mesh should be starting points for pencils.
@@ -819,7 +847,7 @@ void propagatePencil(
  * @param [in] localPropagatedCells List of local cells that get propagated
  * ie. not boundary or DO_NOT_COMPUTE
  * @param [in] dimension Spatial dimension
- * @param [out] seedIds list of cell ids that will be starting points for pencils
+ * @param [out] seedIds list of cell ids that will be starting points for pencils, in ascending order
  */
 void getSeedIds(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                 const vector<CellID> &localPropagatedCells,
@@ -957,6 +985,10 @@ void getSeedIds(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
       }
    }
 
+   // The threads append in arbitrary order, sort so that the pencils built from the seeds
+   // are reproducible, and so that the pencil builder can binary search the seeds
+   std::sort(seedIds.begin(), seedIds.end());
+
    if(debug) {
       cout << "Rank " << myRank << ", Seed ids are: ";
       for (const auto seedId : seedIds) {
@@ -969,60 +1001,47 @@ void getSeedIds(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGr
 
 
 
-/* Copy the data to the temporary values array, so that the
- * dimensions are correctly swapped. Also, copy the same block for
- * then neighboring spatial cells (in the dimension). neighbors
- * generated with compute_spatial_neighbors_wboundcond).
- * Adapted from copy_trans_block_data to be suitable for use with
- * AMR and pencils. 
+/* Gather the data of one velocity block from all source cells of a pencil
+ * into a contiguous stencil buffer, transposed so that the mapping is along
+ * the k direction. The source cells are the VLASOV_STENCIL_WIDTH padded
+ * stencil of the pencil, stored consecutively (see computeSpatialSourceCellsForPencil).
+ * Cells that do not have the block are filled with zeros, which is also the
+ * velocity space boundary.
  *
  * This function must be thread-safe.
  *
- * @param source_neighbors Array containing the VLASOV_STENCIL_WIDTH closest 
- * spatial neighbors of this cell in the propagated dimension.
+ * @param sourceCells Source cells of the pencil, lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH of them.
  * @param blockGID Global ID of the velocity block.
- * @param int lengthOfPencil Number of spatial cells in pencil
- * @param values Vector where loaded data is stored.
+ * @param lengthOfPencil Number of spatial cells in pencil
+ * @param values Aligned stencil buffer where the gathered data is stored.
  * @param cellid_transpose
  * @param popID ID of the particle species.
+ * @param occupied Output occupancy mask, 1 for the source cells that have the block.
+ * @return false if none of the source cells has the block, values is then not written
  */
 bool copy_trans_block_data_amr(
-    SpatialCell** source_neighbors,
+    SpatialCell* const* sourceCells,
     const vmesh::GlobalID blockGID,
     int lengthOfPencil,
     Vec* values,
     const unsigned char* const cellid_transpose,
-    const uint popID) { 
+    const uint popID,
+    uint8_t* occupied) { 
 
-   // Allocate data pointer for all blocks in pencil. Pad on both ends by VLASOV_STENCIL_WIDTH
-   Realf* blockDataPointer[lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH];   
+   const int sourceLength = lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH;
+   // Data pointers of the block in all source cells, NULL if the cell does not have it
+   const Realf* blockDataPointer[sourceLength];
 
    int nonEmptyBlocks = 0;
-
-   for (int b = -VLASOV_STENCIL_WIDTH; b < lengthOfPencil + VLASOV_STENCIL_WIDTH; b++) {
-      // Get cell pointer and local block id
-      SpatialCell* srcCell = source_neighbors[b + VLASOV_STENCIL_WIDTH];
-         
-      const vmesh::LocalID blockLID = srcCell->get_velocity_block_local_id(blockGID,popID);
-      if (blockLID != srcCell->invalid_local_id()) {
-         // Get data pointer
-         blockDataPointer[b + VLASOV_STENCIL_WIDTH] = srcCell->get_data(blockLID,popID);
+   for (int b = 0; b < sourceLength; b++) {
+      const vmesh::LocalID blockLID = sourceCells[b]->get_velocity_block_local_id(blockGID,popID);
+      if (blockLID != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
+         blockDataPointer[b] = sourceCells[b]->get_data(blockLID,popID);
+         occupied[b] = 1;
          nonEmptyBlocks++;
-         // //prefetch storage pointers to L1
-         // _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]), _MM_HINT_T0);
-         // _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 64, _MM_HINT_T0);
-         // _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 128, _MM_HINT_T0);
-         // _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 192, _MM_HINT_T0);
-         // if(VPREC  == 8) {
-         //   //prefetch storage pointers to L1
-         //   _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 256, _MM_HINT_T0);
-         //   _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 320, _MM_HINT_T0);
-         //   _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 384, _MM_HINT_T0);
-         //   _mm_prefetch((char *)(blockDataPointer[b + VLASOV_STENCIL_WIDTH]) + 448, _MM_HINT_T0);
-         // }
-         
       } else {
-         blockDataPointer[b + VLASOV_STENCIL_WIDTH] = NULL;
+         blockDataPointer[b] = NULL;
+         occupied[b] = 0;
       }
    }
    
@@ -1030,35 +1049,40 @@ bool copy_trans_block_data_amr(
       return false;
    }
    
-   //  Copy volume averages of this block from all spatial cells:
-   for (int b = -VLASOV_STENCIL_WIDTH; b < lengthOfPencil + VLASOV_STENCIL_WIDTH; b++) {
-      if(blockDataPointer[b + VLASOV_STENCIL_WIDTH] != NULL) {
-         Realf blockValues[WID3];
-         const Realf* block_data = blockDataPointer[b + VLASOV_STENCIL_WIDTH];
-         // Copy data to a temporary array and transpose values so that mapping is along k direction.
-         // spatial source_neighbors already taken care of when
-         // creating source_neighbors table. If a normal spatial cell does not
-         // simply have the block, its value will be its null_block which
-         // is fine. This null_block has a value of zero in data, and that
-         // is thus the velocity space boundary
+   // Copy volume averages of this block from all spatial cells in one pass
+   // over the stencil. The layout of values is [k][planeVector][b], so
+   // consecutive cells of the pencil are adjacent for the reconstruction.
+   // Empty cells are only zeroed if they are in the stencil of a cell
+   // whose stencil is not empty, i.e., within 2 * VLASOV_STENCIL_WIDTH of
+   // an occupied cell. propagatePencil skips all other cells.
+   int lastOccupied = -1 - 2 * VLASOV_STENCIL_WIDTH;
+   int nextOccupied = -1;
+   for (int b = 0; b < sourceLength; b++) {
+      const Realf* block_data = blockDataPointer[b];
+      if (nextOccupied < b) {
+         nextOccupied = b;
+         while (nextOccupied < sourceLength && blockDataPointer[nextOccupied] == NULL) {
+            nextOccupied++;
+         }
+      }
+      if(block_data != NULL) {
+         lastOccupied = b;
+         Realv blockValues[WID3];
          for (uint i=0; i<WID3; ++i) {
             blockValues[i] = block_data[cellid_transpose[i]];
          }
-         
-         // now load values into the actual values table..
          uint offset =0;
          for (uint k=0; k<WID; k++) {
             for(uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){
-               // store data, when reading data from data we swap dimensions 
-               // using precomputed plane_index_to_id and cell_indices_to_id
-               values[i_trans_ps_blockv_pencil(planeVector, k, b, lengthOfPencil)].load(blockValues + offset);
+               values[i_trans_ps_blockv_pencil(planeVector, k, b - VLASOV_STENCIL_WIDTH, lengthOfPencil)].load(blockValues + offset);
                offset += VECL;
             }
          }
-      } else {
+      } else if (b - lastOccupied <= 2 * VLASOV_STENCIL_WIDTH ||
+                 (nextOccupied < sourceLength && nextOccupied - b <= 2 * VLASOV_STENCIL_WIDTH)) {
          for (uint k=0; k<WID; ++k) {
             for(uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
-               values[i_trans_ps_blockv_pencil(planeVector, k, b, lengthOfPencil)] = Vec(0);
+               values[i_trans_ps_blockv_pencil(planeVector, k, b - VLASOV_STENCIL_WIDTH, lengthOfPencil)] = Vec(0);
             }
          }
       }
@@ -1206,11 +1230,17 @@ void check_ghost_cells(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>
    }
 }
 
-/* Checks that each local spatial cell appears in pencils at least 1 time.
+/* Checks that the pencils cover the cross-section of each local spatial cell
+ * exactly once. A pencil whose path has length p has the cross-section of a
+ * cell of refinement level p, so a cell of level r must be crossed by pencils
+ * whose cross-sections, 4^(r - p) of the cell each, add up to one. This holds
+ * for any number of refinement levels, unlike counting the pencils through a
+ * cell.
  *
  * @param mpiGrid DCCRG grid object
  * @param cells Local spatial cells
  * @param pencils Pencil data struct
+ * @return True if the coverage of all cells is correct
  */
 bool checkPencils(
    const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
@@ -1219,37 +1249,37 @@ bool checkPencils(
 ) {
 
    bool correct = true;
+   const int maxRefLevel = mpiGrid.get_maximum_refinement_level();
 
-   for (auto id : cells) {
-
-      if (mpiGrid[id]->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY )  {
-      
-         int myCount = std::count(pencils.ids.begin(), pencils.ids.end(), id);
-         
-         if( myCount == 0) {
-            
-            std::cerr << "ERROR: Cell ID " << id << " Appears in pencils " << myCount << " times!"<< std::endl;            
+   // Covered cross-section of each cell in units of the cross-section of a
+   // cell on the finest refinement level
+   std::unordered_map<CellID,uint64_t> coverage;
+   for (uint ipencil = 0; ipencil < pencils.N; ++ipencil) {
+      const int pencilRefLevel = pencils.path[ipencil].size();
+      for (uint i = pencils.idsStart[ipencil]; i < pencils.idsStart[ipencil] + pencils.lengthOfPencils[ipencil]; ++i) {
+         const CellID id = pencils.ids[i];
+         if (pencilRefLevel < mpiGrid.get_refinement_level(id)) {
+            std::cerr << "ERROR: Cell ID " << id << " of refinement level " << mpiGrid.get_refinement_level(id)
+                      << " is in pencil " << ipencil << " with a path of length " << pencilRefLevel << std::endl;
             correct = false;
+            continue;
          }
-
+         coverage[id] += 1ull << (2 * (maxRefLevel - pencilRefLevel));
       }
-      
    }
 
-   for (uint ipencil = 0; ipencil < pencils.N; ++ipencil) {
-      cint nPencilsThroughThisCell = pow(pow(2,pencils.path[ipencil].size()),2);
-      auto ids = pencils.getIds(ipencil);
-      
-      for (auto id : ids) {
+   for (auto id : cells) {
 
-         cint myCount = std::count(pencils.ids.begin(), pencils.ids.end(), id);
+      if (mpiGrid[id]->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY )  {
 
-         if (myCount > nPencilsThroughThisCell) {
+         const uint64_t cellCrossSection = 1ull << (2 * (maxRefLevel - mpiGrid.get_refinement_level(id)));
+         const auto it = coverage.find(id);
+         const uint64_t covered = (it == coverage.end()) ? 0 : it->second;
 
-            std::cerr << "ERROR: Cell ID " << id << " Appears in pencils " << myCount << " times!"<< std::endl;
-            std::cerr << "       It should not appear more than " << nPencilsThroughThisCell << " times." << std::endl;
+         if (covered != cellCrossSection) {
+            std::cerr << "ERROR: Cell ID " << id << " is covered by pencils " << (double)covered / cellCrossSection
+                      << " times instead of once!" << std::endl;
             correct = false;
-
          }
 
       }
@@ -1302,6 +1332,200 @@ void printPencilsFunc(const setOfPencils& pencils, const uint dimension, const i
    MPI_Barrier(MPI_COMM_WORLD);
 }
 
+// Target cells of the interior pencils that are also source or target cells of
+// the boundary pencils, one flag per target cell in the layout of
+// computeSpatialTargetCellsForPencilsWithFaces. Set by classifyInteriorPencils.
+static std::array<std::vector<uint8_t>,3> deferredTargets;
+// Deferred target cells that no boundary pencil writes into
+static std::array<std::vector<SpatialCell*>,3> deferredZeroCells;
+
+// A velocity block that an interior pencil mapped into a deferred target cell,
+// stored after the boundary pencils have been propagated
+struct DeferredTargetBlock {
+   SpatialCell* cell;
+   vmesh::GlobalID blockGID;
+   uint slot; // Index of the target cell, keeps the order of the sums fixed
+   std::array<Realf,WID3> data;
+};
+static std::vector<DeferredTargetBlock> deferredTargetBlocks;
+
+/* Split the pencils into segments that can be propagated before the ghost cells
+ * are updated, and segments that cannot. A cell of a pencil is interior if all
+ * the source cells of its stencil are local, and it is not sent to the other
+ * processes in the translation neighborhood. Each run of interior or boundary
+ * cells of a pencil becomes a pencil of its own, as long as the segments have
+ * the same source and target cells as the cells had in the whole pencil. A
+ * pencil only maps the density of its own cells, so the segments give the
+ * same result as the pencil, up to the order of the sums in the cells at the cuts.
+ *
+ * The interior pencils are propagated while the stencil data of the remote
+ * cells is transferred, and the boundary pencils after that. The target cells
+ * of the interior pencils that the boundary pencils read or write are stored
+ * after the boundary pencils, see storeDeferredTargets.
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ * @param [in,out] pencils Pencil data struct, split into segments and interior set for each of them
+ * @param [in] dimension Spatial dimension
+ */
+void classifyInteriorPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                             setOfPencils& pencils,
+                             const uint dimension) {
+
+   const vector<CellID>& localCells = getLocalCells();
+   std::unordered_set<SpatialCell*> localCellPointers;
+   for (const CellID cell : localCells) {
+      localCellPointers.insert(mpiGrid[cell]);
+   }
+   // The data of these cells is being sent while the interior pencils are propagated
+   std::unordered_set<SpatialCell*> sentCells;
+   for (const CellID cell : mpiGrid.get_local_cells_on_process_boundary(getNeighborhood(dimension,VLASOV_STENCIL_WIDTH))) {
+      sentCells.insert(mpiGrid[cell]);
+   }
+
+   setOfPencils segments;
+   segments.reserve(pencils.N, pencils.sumOfLengths);
+   std::vector<SpatialCell*> sourceCells;
+   std::vector<SpatialCell*> targetCells;
+   std::vector<SpatialCell*> segmentSourceCells;
+   std::vector<SpatialCell*> segmentTargetCells;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      const uint L = pencils.lengthOfPencils[pencili];
+      const vector<CellID> ids = pencils.getIds(pencili);
+      setOfPencils pencil;
+      pencil.addPencil(ids, pencils.x[pencili], pencils.y[pencili], pencils.periodic[pencili], pencils.path[pencili]);
+      sourceCells.resize(L + 2 * VLASOV_STENCIL_WIDTH);
+      computeSpatialSourceCellsForPencil(mpiGrid, pencil, 0, dimension, sourceCells.data());
+
+      std::vector<uint8_t> cellInterior(L);
+      for (uint i = 0; i < L; ++i) {
+         cellInterior[i] = sentCells.count(sourceCells[i + VLASOV_STENCIL_WIDTH]) == 0;
+         for (uint j = i; j <= i + 2 * VLASOV_STENCIL_WIDTH && cellInterior[i]; ++j) {
+            cellInterior[i] = localCellPointers.count(sourceCells[j]) > 0;
+         }
+      }
+
+      setOfPencils pieces;
+      uint begin = 0;
+      for (uint i = 1; i <= L; ++i) {
+         if (i == L || cellInterior[i] != cellInterior[begin]) {
+            pieces.addPencil(vector<CellID>(ids.begin() + begin, ids.begin() + i), pencils.x[pencili], pencils.y[pencili],
+                             pencils.periodic[pencili], pencils.path[pencili]);
+            pieces.interior.back() = cellInterior[begin];
+            begin = i;
+         }
+      }
+
+      // The neighbors of the cells at the cuts could differ from those in the
+      // whole pencil where the refinement changes, keep such pencils whole
+      bool sameCells = true;
+      if (pieces.N > 1) {
+         targetCells.resize(L + 2);
+         computeSpatialTargetCellsForPencilsWithFaces(mpiGrid, pencil, dimension, targetCells.data());
+         segmentTargetCells.resize(pieces.sumOfLengths + 2 * pieces.N);
+         computeSpatialTargetCellsForPencilsWithFaces(mpiGrid, pieces, dimension, segmentTargetCells.data());
+         uint offset = 0;
+         for (uint piecei = 0; piecei < pieces.N && sameCells; ++piecei) {
+            const uint segmentL = pieces.lengthOfPencils[piecei];
+            segmentSourceCells.resize(segmentL + 2 * VLASOV_STENCIL_WIDTH);
+            computeSpatialSourceCellsForPencil(mpiGrid, pieces, piecei, dimension, segmentSourceCells.data());
+            sameCells = std::equal(segmentSourceCells.begin(), segmentSourceCells.end(), sourceCells.begin() + offset) &&
+               std::equal(segmentTargetCells.begin() + offset + 2 * piecei, segmentTargetCells.begin() + offset + 2 * piecei + segmentL + 2,
+                          targetCells.begin() + offset);
+            offset += segmentL;
+         }
+      }
+
+      if (sameCells) {
+         segments.addPencils(pieces);
+      } else {
+         pencil.interior[0] = std::all_of(cellInterior.begin(), cellInterior.end(), [](uint8_t interior) {return interior != 0;});
+         segments.addPencils(pencil);
+      }
+   }
+   pencils = segments;
+
+   // Cells that the boundary pencils read or write, and those they write
+   std::unordered_set<SpatialCell*> boundaryPencilCells;
+   std::unordered_set<SpatialCell*> boundaryTargetCells;
+   targetCells.resize(pencils.sumOfLengths + 2 * pencils.N);
+   computeSpatialTargetCellsForPencilsWithFaces(mpiGrid, pencils, dimension, targetCells.data());
+   uint targetStart = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      const uint targetLength = pencils.lengthOfPencils[pencili] + 2;
+      if (!pencils.interior[pencili]) {
+         sourceCells.resize(pencils.lengthOfPencils[pencili] + 2 * VLASOV_STENCIL_WIDTH);
+         computeSpatialSourceCellsForPencil(mpiGrid, pencils, pencili, dimension, sourceCells.data());
+         boundaryPencilCells.insert(sourceCells.begin(), sourceCells.end());
+         boundaryPencilCells.insert(targetCells.begin() + targetStart, targetCells.begin() + targetStart + targetLength);
+         boundaryTargetCells.insert(targetCells.begin() + targetStart, targetCells.begin() + targetStart + targetLength);
+      }
+      targetStart += targetLength;
+   }
+
+   // The interior pencils must not update these in place, the boundary pencils need the old data
+   deferredTargets[dimension].assign(targetCells.size(), 0);
+   std::unordered_set<SpatialCell*> zeroCells;
+   targetStart = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      const uint targetLength = pencils.lengthOfPencils[pencili] + 2;
+      if (pencils.interior[pencili]) {
+         for (uint i = targetStart; i < targetStart + targetLength; ++i) {
+            if (targetCells[i] && boundaryPencilCells.count(targetCells[i]) > 0) {
+               deferredTargets[dimension][i] = true;
+               if (boundaryTargetCells.count(targetCells[i]) == 0) {
+                  zeroCells.insert(targetCells[i]);
+               }
+            }
+         }
+      }
+      targetStart += targetLength;
+   }
+   deferredZeroCells[dimension].assign(zeroCells.begin(), zeroCells.end());
+}
+
+/* Store the velocity blocks that the interior pencils mapped into the deferred
+ * target cells (see classifyInteriorPencils). Called after the boundary pencils
+ * have been propagated, which already zeroed the cells they write into.
+ *
+ * @param [in] dimension Spatial dimension
+ * @param [in] popID Particle population ID
+ */
+static void storeDeferredTargets(const uint dimension, const uint popID) {
+   const std::vector<SpatialCell*>& zeroCells = deferredZeroCells[dimension];
+   #pragma omp parallel for
+   for (uint c = 0; c < zeroCells.size(); ++c) {
+      Realf* data = zeroCells[c]->get_data(popID);
+      std::fill(data, data + zeroCells[c]->get_number_of_velocity_blocks(popID) * WID3, 0.0);
+   }
+
+   // Several pencils write into the same cells, add the blocks of each cell in a fixed order
+   std::sort(deferredTargetBlocks.begin(), deferredTargetBlocks.end(),
+             [](const DeferredTargetBlock& a, const DeferredTargetBlock& b) {
+                return a.cell != b.cell ? std::less<SpatialCell*>()(a.cell, b.cell) :
+                   (a.blockGID != b.blockGID ? a.blockGID < b.blockGID : a.slot < b.slot);
+             });
+   std::vector<size_t> cellStart;
+   for (size_t i = 0; i < deferredTargetBlocks.size(); ++i) {
+      if (i == 0 || deferredTargetBlocks[i].cell != deferredTargetBlocks[i - 1].cell) {
+         cellStart.push_back(i);
+      }
+   }
+   cellStart.push_back(deferredTargetBlocks.size());
+
+   #pragma omp parallel for schedule(dynamic)
+   for (size_t c = 0; c < cellStart.size() - 1; ++c) {
+      for (size_t i = cellStart[c]; i < cellStart[c + 1]; ++i) {
+         const DeferredTargetBlock& block = deferredTargetBlocks[i];
+         const vmesh::LocalID blockLID = block.cell->get_velocity_block_local_id(block.blockGID, popID);
+         Realf* blockData = block.cell->get_data(blockLID, popID);
+         for (int j = 0; j < WID3; j++) {
+            blockData[j] += block.data[j];
+         }
+      }
+   }
+   deferredTargetBlocks.clear();
+}
+
 /* Wrapper function for calling seed ID selection and pencil generation, per dimension.
  * Includes threading and gathering of pencils into thread-containers.
  *
@@ -1337,6 +1561,9 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
    // Clear previous set
    DimensionPencils[dimension].removeAllPencils();
    
+   // Each seed builds its pencils into its own set. The seeds vary a lot in cost (a seed
+   // next to a refinement boundary splits into many pencils), hence the dynamic schedule.
+   vector<setOfPencils> seedPencils(seedIds.size());
 #pragma omp parallel
    {
       // Empty vectors for internal use of buildPencilsWithNeighbors. Could be default values but
@@ -1344,29 +1571,24 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
       // https://stackoverflow.com/questions/3147274/c-default-argument-for-vectorint
       vector<CellID> ids;
       vector<uint> path;
-      // thread-internal pencil set to be accumulated at the end
-      setOfPencils thread_pencils;
-      // iterators used in the accumulation
-      std::vector<CellID>::iterator ibeg, iend;
 
-#pragma omp for schedule(guided)
+#pragma omp for schedule(dynamic)
       for (uint i=0; i<seedIds.size(); i++) {
-         cuint seedId = seedIds[i];
-         // Construct pencils from the seedIds into a set of pencils.
-         thread_pencils = buildPencilsWithNeighbors(mpiGrid, thread_pencils, seedId, ids, dimension, path, seedIds);
+         buildPencilsWithNeighbors(mpiGrid, seedPencils[i], seedIds[i], ids, dimension, path, seedIds);
       }
+   }
 
-      // accumulate thread results in global set of pencils
-#pragma omp critical
-      {
-         for (uint i=0; i<thread_pencils.N; i++) {
-            // Use vector range constructor
-            ibeg = thread_pencils.ids.begin() + thread_pencils.idsStart[i];
-            iend = ibeg + thread_pencils.lengthOfPencils[i];
-            std::vector<CellID> pencilIds(ibeg, iend);
-            DimensionPencils[dimension].addPencil(pencilIds,thread_pencils.x[i],thread_pencils.y[i],thread_pencils.periodic[i],thread_pencils.path[i]);
-         }
-      }
+   // Gather the pencils in the order of the seeds, so that the set does not depend on the
+   // number of threads or on their timing
+   uint nPencils = 0;
+   uint nIds = 0;
+   for (const setOfPencils& pencils : seedPencils) {
+      nPencils += pencils.N;
+      nIds += pencils.sumOfLengths;
+   }
+   DimensionPencils[dimension].reserve(nPencils, nIds);
+   for (const setOfPencils& pencils : seedPencils) {
+      DimensionPencils[dimension].addPencils(pencils);
    }
 
    phiprof::Timer checkGhostsTimer {"check_ghost_cells"};
@@ -1374,6 +1596,18 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
    check_ghost_cells(mpiGrid,DimensionPencils[dimension],dimension);
    checkGhostsTimer.stop();
 
+   if (P::vlasovTranslationOverlap) {
+      phiprof::Timer classifyTimer {"classifyInteriorPencils"};
+      classifyInteriorPencils(mpiGrid,DimensionPencils[dimension],dimension);
+   }
+
+#ifdef DEBUG_VLASOV_SOLVER
+   if(!checkPencils(mpiGrid, localPropagatedCells, DimensionPencils[dimension])) {
+      std::cerr<<"abort checkpencils"<<std::endl;
+      abort();
+   }
+#endif
+
    // ****************************************************************************
 
    if(printPencils) {
@@ -1382,6 +1616,93 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
    buildPencilsTimer.stop();
 }
 
+// Version of the grid partition and refinement, and the version the cached pencils were built for
+static uint gridVersion = 1;
+static uint pencilsVersion = 0;
+// Number of local cells when the pencils were built, a cheap consistency check of the cache
+static size_t pencilsLocalCells = 0;
+// Wall time of the last pencil build and the number of translations that reused its result
+static double pencilsBuildTime = 0.0;
+static uint pencilsReuses = 0;
+// Velocity blocks propagated through pencil cells since the pencils were last
+// invalidated, and how many of them were skipped as empty
+static uint64_t propagatedPencilCells = 0;
+static uint64_t skippedEmptyPencilCells = 0;
+
+/* Mark the cached pencils stale, called when the dccrg partition or the spatial
+ * refinement changes. Reports the estimated pencil building time saved by reusing
+ * the previous set.
+ */
+void invalidatePencils() {
+   if (pencilsVersion == gridVersion && pencilsReuses > 0) {
+      logFile << "(AMR): Pencils were reused in " << pencilsReuses << " translations, saving an estimated "
+              << pencilsReuses * pencilsBuildTime << " s of pencil building on this process" << endl << writeVerbose;
+   }
+   if (propagatedPencilCells > 0) {
+      logFile << "(AMR): " << skippedEmptyPencilCells << " of " << propagatedPencilCells
+              << " velocity blocks in pencil cells were skipped as empty on this process" << endl << writeVerbose;
+   }
+   propagatedPencilCells = 0;
+   skippedEmptyPencilCells = 0;
+   ++gridVersion;
+}
+
+/* Check whether the cached pencils were built for the current grid.
+ *
+ * @return true if the pencils can be used as they are
+ */
+bool pencilsAreValid() {
+   return pencilsVersion == gridVersion && pencilsLocalCells == getLocalCells().size();
+}
+
+/* Rebuild the pencils in all dimensions if the grid changed since they were
+ * last built, otherwise reuse the cached ones.
+ *
+ * @param [in] mpiGrid DCCRG grid object
+ */
+void preparePencilsIfInvalid(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+   if (pencilsAreValid()) {
+      ++pencilsReuses;
+      return;
+   }
+
+   phiprof::Timer timer {"GetSeedIdsAndBuildPencils"};
+   const double t1 = MPI_Wtime();
+   for (uint dimension=0; dimension<3; dimension++) {
+      prepareSeedIdsAndPencils(mpiGrid,dimension);
+   }
+   pencilsBuildTime = MPI_Wtime() - t1;
+   if (P::vlasovTranslationOverlap) {
+      for (uint dimension=0; dimension<3; dimension++) {
+         const setOfPencils& pencils = DimensionPencils[dimension];
+         uint interiorPencils = 0;
+         uint interiorCells = 0;
+         for (uint pencili = 0; pencili < pencils.N; ++pencili) {
+            if (pencils.interior[pencili]) {
+               interiorPencils++;
+               interiorCells += pencils.lengthOfPencils[pencili];
+            }
+         }
+         logFile << "(AMR): " << interiorCells << " of " << pencils.sumOfLengths << " pencil cells in " << "xyz"[dimension]
+                 << " (" << interiorPencils << " of " << pencils.N << " pencils) are propagated during the ghost cell transfer on this process"
+                 << endl << writeVerbose;
+      }
+   }
+   pencilsVersion = gridVersion;
+   pencilsLocalCells = getLocalCells().size();
+   pencilsReuses = 0;
+}
+
+/* Get the pencils of a dimension built by prepareSeedIdsAndPencils. DimensionPencils
+ * is static, so code in other translation units has to access it through this.
+ *
+ * @param [in] dimension Spatial dimension
+ * @return Pencils of the dimension
+ */
+const setOfPencils& getPencils(const uint dimension) {
+   return DimensionPencils[dimension];
+}
+
 /* Map velocity blocks in all local cells forward by one time step in one spatial dimension.
  * This function uses 1-cell wide pencils to update cells in-place to avoid allocating large
  * temporary buffers.
@@ -1393,6 +1714,7 @@ void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
  * @param [in] dimension Spatial dimension
  * @param [in] dt Time step
  * @param [in] popId Particle population ID
+ * @param [in] selection Propagate all pencils, or only the interior or the boundary ones (see classifyInteriorPencils)
  */
 bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                       const vector<CellID>& localPropagatedCells,
@@ -1400,7 +1722,8 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                       std::vector<uint>& nPencils,
                       const uint dimension,
                       const Realv dt,
-                      const uint popID) {
+                      const uint popID,
+                      const pencil_selection selection) {
    phiprof::Timer setupTimer {"setup"};
    uint cell_indices_to_id[3]; /*< used when computing id of target cell in block*/
    unsigned char  cellid_transpose[WID3]; /*< defines the transpose for the solver internal (transposed) id: i + j*WID + k*WID2 to actual one*/
@@ -1455,7 +1778,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    // ****************************************************************************
 
    // compute pencils => set of pencils (shared datastructure)
-   // prepareSeedIdsAndPencils(mpiGrid,dimension); // moved to grid.cpp
+   // Pencils are prepared by preparePencilsIfInvalid() in calculateSpatialTranslation
 
    // init cellid_transpose (moved here to take advantage of the omp parallel region)
 #pragma omp parallel for collapse(2)
@@ -1471,13 +1794,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       }
    }
 
-   // Warning: checkPencils fails to understand situations where pencils reach across 3 levels of refinement.
-   // if(!checkPencils(mpiGrid, localPropagatedCells, pencils)) {
-   //    std::cerr<<"abort checkpencils"<<std::endl;
-   //    abort();
-   // }
-   
-   if (Parameters::prepareForRebalance == true) {
+   if (Parameters::prepareForRebalance == true && selection != BOUNDARY_PENCILS) {
       for (uint i=0; i<localPropagatedCells.size(); i++) {
          cuint myPencilCount = std::count(DimensionPencils[dimension].ids.begin(), DimensionPencils[dimension].ids.end(), localPropagatedCells[i]);
          nPencils[i] += myPencilCount;
@@ -1490,34 +1807,11 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    
    phiprof::Timer buildBlockListimer {"buildBlockList"};
    // Get a unique sorted list of blockids that are in any of the
-   // propagated cells. First use set for this, then add to vector (may not
-   // be the most nice way to do this and in any case we could do it along
-   // dimension for data locality reasons => copy acc map column code, TODO: FIXME
+   // propagated cells.
    // TODO: Do this separately for each pencil?
    std::vector<vmesh::GlobalID> unionOfBlocks;
-   std::unordered_set<vmesh::GlobalID> unionOfBlocksSet;
-//   unionOfBlocks.reserve(unionOfBlocksSet.size());
-#pragma omp parallel
-   {
-      std::unordered_set<vmesh::GlobalID> thread_unionOfBlocksSet;
-      
-#pragma omp for
-      for(unsigned int i=0; i<allCellsPointer.size(); i++) {
-         auto cell = &allCellsPointer[i];
-         vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& cvmesh = (*cell)->get_velocity_mesh(popID);
-         for (vmesh::LocalID block_i=0; block_i< cvmesh.size(); ++block_i) {
-            thread_unionOfBlocksSet.insert(cvmesh.getGlobalID(block_i));
-         }
-      }
+   get_union_of_blocks(allCellsPointer, popID, unionOfBlocks);
 
-#pragma omp critical
-      {
-         unionOfBlocksSet.insert(thread_unionOfBlocksSet.begin(), thread_unionOfBlocksSet.end());
-      } // pragma omp critical
-   } // pragma omp parallel
-   
-   unionOfBlocks.insert(unionOfBlocks.end(), unionOfBlocksSet.begin(), unionOfBlocksSet.end());
-   
    buildBlockListimer.stop();
    // ****************************************************************************
    
@@ -1537,43 +1831,57 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    int mappingId {phiprof::initializeTimer("mapping")};
    int storeId {phiprof::initializeTimer("store")};
    
-   #pragma omp parallel
+   // Flat structure-of-arrays layout of the source stencils of all pencils:
+   // the lengthOfPencil + 2 * VLASOV_STENCIL_WIDTH source cells of pencil i
+   // and their widths in the direction of the pencil start at sourceStart[i].
+   phiprof::Timer computeSourcesTimer {"computeSpatialSourceCellsForPencils"};
+   setOfPencils& pencils = DimensionPencils[dimension];
+   // Pencils propagated in this call
+   std::vector<uint8_t> pencilSelected(pencils.N);
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      pencilSelected[pencili] = selection == ALL_PENCILS || (pencils.interior[pencili] != 0) == (selection == INTERIOR_PENCILS);
+   }
+   std::vector<uint> sourceStart(pencils.N + 1, 0);
+   uint maxLengthOfPencils = 0;
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      sourceStart[pencili + 1] = sourceStart[pencili] + pencils.lengthOfPencils[pencili] + 2 * VLASOV_STENCIL_WIDTH;
+      maxLengthOfPencils = max(maxLengthOfPencils, pencils.lengthOfPencils[pencili]);
+   }
+   std::vector<SpatialCell*> sourceCells(sourceStart[pencils.N]);
+   std::vector<Vec, aligned_allocator<Vec,WID3>> sourceDz(sourceStart[pencils.N]);
+   #pragma omp parallel for schedule(dynamic)
+   for(uint pencili = 0; pencili < pencils.N; ++pencili) {
+      if (!pencilSelected[pencili]) continue;
+      // In source cells we have a wider stencil and take into account boundaries.
+      computeSpatialSourceCellsForPencil(mpiGrid, pencils, pencili, dimension, sourceCells.data() + sourceStart[pencili]);
+      for(uint i = sourceStart[pencili]; i < sourceStart[pencili + 1]; ++i) {
+         sourceDz[i] = sourceCells[i]->parameters[CellParams::DX+dimension];
+      }
+   }
+   computeSourcesTimer.stop();
+
+   // Cells of the propagated pencils, counted once per velocity block, and
+   // those of them skipped because there was no data in their stencil
+   uint64_t totalPencilCells = 0;
+   uint64_t skippedPencilCells = 0;
+
+   // Target cells whose blocks the interior pencils do not store in place (see classifyInteriorPencils)
+   const std::vector<uint8_t>& deferred = deferredTargets[dimension];
+   if (selection == INTERIOR_PENCILS) {
+      deferredTargetBlocks.clear();
+   }
+
+   #pragma omp parallel reduction(+:totalPencilCells,skippedPencilCells)
    {
+      std::vector<DeferredTargetBlock> threadDeferredBlocks;
       // declarations for variables needed by the threads
       std::vector<Realf, aligned_allocator<Realf, WID3>> targetBlockData((DimensionPencils[dimension].sumOfLengths + 2 * nTargetNeighborsPerPencil * DimensionPencils[dimension].N) * WID3);
-      std::vector<std::vector<SpatialCell*>> pencilSourceCells;
       
-      // Allocate aligned vectors which are needed once per pencil to avoid reallocating once per block loop + pencil loop iteration
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencilTargetValues;
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencilSourceVecData;
-      std::vector<std::vector<Vec, aligned_allocator<Vec,WID3>>> pencildz;
-      
-      for(uint pencili = 0; pencili < DimensionPencils[dimension].N; ++pencili) {
-         
-         cint L = DimensionPencils[dimension].lengthOfPencils[pencili];
-         cuint sourceLength = L + 2 * VLASOV_STENCIL_WIDTH;
-         
-         // Vector buffer where we write data, initialized to 0*/
-         std::vector<Vec, aligned_allocator<Vec,WID3>> targetValues((L + 2 * nTargetNeighborsPerPencil) * WID3 / VECL);
-         pencilTargetValues.push_back(targetValues);
-         // Allocate source data: sourcedata<length of pencil * WID3)
-         // Add padding by 2 * VLASOV_STENCIL_WIDTH
-         std::vector<Vec, aligned_allocator<Vec,WID3>> sourceVecData(sourceLength * WID3 / VECL);
-         pencilSourceVecData.push_back(sourceVecData);
-
-         // Compute spatial neighbors for the source cells of the pencil. In
-         // source cells we have a wider stencil and take into account boundaries.
-         std::vector<SpatialCell*> sourceCells(sourceLength);
-         computeSpatialSourceCellsForPencil(mpiGrid, DimensionPencils[dimension], pencili, dimension, sourceCells.data());
-         pencilSourceCells.push_back(sourceCells);
-
-         // dz is the cell size in the direction of the pencil
-         std::vector<Vec, aligned_allocator<Vec,WID3>> dz(sourceLength);
-         for(uint i = 0; i < sourceCells.size(); ++i) {
-            dz[i] = sourceCells[i]->parameters[CellParams::DX+dimension];
-         }
-         pencildz.push_back(dz);
-      }
+      // Aligned stencil buffers, sized for the longest pencil and reused for all pencils and blocks
+      std::vector<Vec, aligned_allocator<Vec,WID3>> targetValues((maxLengthOfPencils + 2 * nTargetNeighborsPerPencil) * WID3 / VECL);
+      std::vector<Vec, aligned_allocator<Vec,WID3>> sourceVecData((maxLengthOfPencils + 2 * VLASOV_STENCIL_WIDTH) * WID3 / VECL);
+      // Occupancy mask of the current block in the source cells of the pencil
+      std::vector<uint8_t> occupied(maxLengthOfPencils + 2 * VLASOV_STENCIL_WIDTH);
       
       // Loop over velocity space blocks. Thread this loop (over vspace blocks) with OpenMP.
       #pragma omp for schedule(guided,8)
@@ -1591,19 +1899,27 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                
                int L = DimensionPencils[dimension].lengthOfPencils[pencili];
                uint targetLength = L + 2 * nTargetNeighborsPerPencil;
+
+               if(!pencilSelected[pencili]) {
+                  totalTargetLength += targetLength;
+                  continue;
+               }
+               totalPencilCells += L;
                               
                // load data(=> sourcedata) / (proper xy reconstruction in future)
-               bool pencil_has_data = copy_trans_block_data_amr(pencilSourceCells[pencili].data(), blockGID, L, pencilSourceVecData[pencili].data(),
-                                         cellid_transpose, popID);
+               SpatialCell* const* pencilSourceCells = sourceCells.data() + sourceStart[pencili];
+               bool pencil_has_data = copy_trans_block_data_amr(pencilSourceCells, blockGID, L, sourceVecData.data(),
+                                         cellid_transpose, popID, occupied.data());
 
                if(!pencil_has_data) {
+                  skippedPencilCells += L;
                   totalTargetLength += targetLength;
                   continue;
                }
 
                // Dz and sourceVecData are both padded by VLASOV_STENCIL_WIDTH
                // Dz has 1 value/cell, sourceVecData has WID3 values/cell
-               propagatePencil(pencildz[pencili].data(), pencilSourceVecData[pencili].data(), pencilTargetValues[pencili].data(), dimension, blockGID, dt, vmesh, L, pencilSourceCells[pencili][0]->getVelocityBlockMinValue(popID));
+               skippedPencilCells += propagatePencil(sourceDz.data() + sourceStart[pencili], sourceVecData.data(), targetValues.data(), dimension, blockGID, dt, vmesh, L, pencilSourceCells[0]->getVelocityBlockMinValue(popID), occupied.data());
 
                // sourceVecData => targetBlockData[this pencil])
 
@@ -1615,9 +1931,8 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                      for(uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){
 
                         // Unpack the vector data
-                        Realf vector[VECL];
-                        //pencilSourceVecData[pencili][i_trans_ps_blockv_pencil(planeVector, k, icell - 1, L)].store(vector);
-                        pencilTargetValues[pencili][i_trans_pt_blockv(planeVector, k, icell - 1)].store(vector);
+                        Realv vector[VECL];
+                        targetValues[i_trans_pt_blockv(planeVector, k, icell - 1)].store(vector);
 
                         // Loop over 3rd (vectorized) vspace dimension
                         for (uint iv = 0; iv < VECL; iv++) {
@@ -1632,7 +1947,7 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                }
                totalTargetLength += targetLength;
                
-            } // Closes loop over pencils. SourceVecData gets implicitly deallocated here.
+            } // Closes loop over pencils.
 
             mappingTimer.stop();
             phiprof::Timer storeTimer {storeId};
@@ -1640,25 +1955,36 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
             // reset blocks in all non-sysboundary neighbor spatial cells for this block id
             // At this point the block data is saved in targetBlockData so we can reset the spatial cells
 
-            for (auto *spatial_cell: targetCells) {
-               // Check for null and system boundary
-               if (spatial_cell && spatial_cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) {
+            totalTargetLength = 0;
+            for(uint pencili = 0; pencili < DimensionPencils[dimension].N; pencili++){
+               uint targetLength = DimensionPencils[dimension].lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+               if(!pencilSelected[pencili]) {
+                  totalTargetLength += targetLength;
+                  continue;
+               }
+               for ( uint celli = 0; celli < targetLength; celli++ ) {
+                  if (selection == INTERIOR_PENCILS && deferred[celli + totalTargetLength]) continue;
+                  SpatialCell* spatial_cell = targetCells[celli + totalTargetLength];
+                  // Check for null and system boundary
+                  if (spatial_cell && spatial_cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) {
                   
-                  // Get local velocity block id
-                  const vmesh::LocalID blockLID = spatial_cell->get_velocity_block_local_id(blockGID, popID);
+                     // Get local velocity block id
+                     const vmesh::LocalID blockLID = spatial_cell->get_velocity_block_local_id(blockGID, popID);
                   
-                  // Check for invalid block id
-                  if (blockLID != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
+                     // Check for invalid block id
+                     if (blockLID != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) {
                      
-                     // Get a pointer to the block data
-                     Realf* blockData = spatial_cell->get_data(blockLID, popID);
+                        // Get a pointer to the block data
+                        Realf* blockData = spatial_cell->get_data(blockLID, popID);
                      
-                     // Loop over velocity block cells
-                     for(int i = 0; i < WID3; i++) {
-                        blockData[i] = 0.0;
+                        // Loop over velocity block cells
+                        for(int i = 0; i < WID3; i++) {
+                           blockData[i] = 0.0;
+                        }
                      }
                   }
                }
+               totalTargetLength += targetLength;
             }
 
             // store_data(target_data => targetCells)  :Aggregate data for blockid to original location 
@@ -1667,6 +1993,10 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
             for(uint pencili = 0; pencili < DimensionPencils[dimension].N; pencili++){
                
                uint targetLength = DimensionPencils[dimension].lengthOfPencils[pencili] + 2 * nTargetNeighborsPerPencil;
+               if(!pencilSelected[pencili]) {
+                  totalTargetLength += targetLength;
+                  continue;
+               }
                
                // store values from targetBlockData array to the actual blocks
                // Loop over cells in the pencil, including the padded cells of the target array
@@ -1697,6 +2027,14 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                         ratio = 1 << -diff;
                         areaRatio = 1.0 / (ratio*ratio);
                      }
+
+                     if (selection == INTERIOR_PENCILS && deferred[GID]) {
+                        threadDeferredBlocks.push_back({targetCell, blockGID, GID, {}});
+                        for(int i = 0; i < WID3 ; i++) {
+                           threadDeferredBlocks.back().data[i] = targetBlockData[GID * WID3 + i] * areaRatio;
+                        }
+                        continue;
+                     }
                      
                      for(int i = 0; i < WID3 ; i++) {
                         blockData[i] += targetBlockData[GID * WID3 + i] * areaRatio;
@@ -1710,8 +2048,21 @@ bool trans_map_1d_amr(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
 
             storeTimer.stop();
       } // Closes loop over blocks
+
+      if (!threadDeferredBlocks.empty()) {
+         #pragma omp critical
+         deferredTargetBlocks.insert(deferredTargetBlocks.end(), threadDeferredBlocks.begin(), threadDeferredBlocks.end());
+      }
    } // closes pragma omp parallel
 
+   if (selection == BOUNDARY_PENCILS) {
+      phiprof::Timer deferredTimer {"storeDeferredTargets"};
+      storeDeferredTargets(dimension, popID);
+   }
+
+   propagatedPencilCells += totalPencilCells;
+   skippedEmptyPencilCells += skippedPencilCells;
+
    return true;
 }
 
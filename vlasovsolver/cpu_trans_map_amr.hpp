@@ -37,8 +37,9 @@ struct setOfPencils {
    std::vector< CellID > ids; // List of cells
    std::vector< uint > idsStart; // List of where a pencil's CellIDs start in the ids array
    std::vector< Realv > x,y; // x,y - position
-   std::vector< bool > periodic;
+   std::vector< uint8_t > periodic; // Not vector<bool>, so that elements are addressable and independent
    std::vector< std::vector<uint> > path; // Path taken through refinement levels
+   std::vector< uint8_t > interior; // Pencil can be propagated before the ghost cells are updated, see classifyInteriorPencils
 
    setOfPencils() {
       
@@ -58,6 +59,7 @@ struct setOfPencils {
       y.clear();
       periodic.clear();
       path.clear();
+      interior.clear();
    }
 
 
@@ -72,6 +74,36 @@ struct setOfPencils {
       y.push_back(yIn);
       periodic.push_back(periodicIn);
       path.push_back(pathIn);
+      interior.push_back(false);
+   }
+
+   void reserve(const uint nPencils, const uint nIds) {
+
+      lengthOfPencils.reserve(nPencils);
+      idsStart.reserve(nPencils);
+      ids.reserve(nIds);
+      x.reserve(nPencils);
+      y.reserve(nPencils);
+      periodic.reserve(nPencils);
+      path.reserve(nPencils);
+      interior.reserve(nPencils);
+   }
+
+   // Append all pencils of another set, in their order in that set
+   void addPencils(const setOfPencils& other) {
+
+      for (uint i = 0; i < other.N; i++) {
+         idsStart.push_back(ids.size() + other.idsStart[i]);
+      }
+      N += other.N;
+      sumOfLengths += other.sumOfLengths;
+      lengthOfPencils.insert(lengthOfPencils.end(),other.lengthOfPencils.begin(),other.lengthOfPencils.end());
+      ids.insert(ids.end(),other.ids.begin(),other.ids.end());
+      x.insert(x.end(),other.x.begin(),other.x.end());
+      y.insert(y.end(),other.y.begin(),other.y.end());
+      periodic.insert(periodic.end(),other.periodic.begin(),other.periodic.end());
+      path.insert(path.end(),other.path.begin(),other.path.end());
+      interior.insert(interior.end(),other.interior.begin(),other.interior.end());
    }
 
    void removePencil(const uint pencilId) {
@@ -80,6 +112,7 @@ struct setOfPencils {
       y.erase(y.begin() + pencilId);
       periodic.erase(periodic.begin() + pencilId);
       path.erase(path.begin() + pencilId);
+      interior.erase(interior.begin() + pencilId);
 
       uint ibeg = idsStart[pencilId];
       ids.erase(ids.begin() + ibeg, ids.begin() + ibeg + lengthOfPencils[pencilId]);
@@ -187,13 +220,17 @@ struct setOfPencils {
 };
 
 
+// Pencils propagated by one call of trans_map_1d_amr
+enum pencil_selection {ALL_PENCILS, INTERIOR_PENCILS, BOUNDARY_PENCILS};
+
 bool trans_map_1d_amr(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                   const std::vector<CellID>& localPropagatedCells,
                   const std::vector<CellID>& remoteTargetCells,
                   std::vector<uint>& nPencils,
                   const uint dimension,
                   const Realv dt,
-                  const uint popID);
+                  const uint popID,
+                  const pencil_selection selection = ALL_PENCILS);
 
 void update_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCell,
                                             dccrg::Cartesian_Geometry>& mpiGrid,
@@ -201,10 +238,23 @@ void update_remote_mapping_contribution_amr(dccrg::Dccrg<spatial_cell::SpatialCe
                                             int direction,
                                             const uint popID);
 
-// grid.cpp calls this function to both find seed cells and build pencils
+// find seed cells and build pencils
 void prepareSeedIdsAndPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                               const uint dimension);
 
+// Pencils are cached across time steps. grid.cpp invalidates them whenever the
+// partition or the refinement of the grid changes, and they are rebuilt before
+// the next translation.
+void invalidatePencils();
+bool pencilsAreValid();
+void preparePencilsIfInvalid(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+const setOfPencils& getPencils(const uint dimension);
+
+// Check that the pencils cover each local cell exactly once
+bool checkPencils(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                  const std::vector<CellID> &cells,
+                  const setOfPencils& pencils);
+
 // pencils used for AMR translation
 static std::array<setOfPencils,3> DimensionPencils;
 
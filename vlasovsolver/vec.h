@@ -49,6 +49,35 @@ VEC8F_AGNER
  - Vector length of 8
  - Use Agner's vectorclass with AVX intrinisics
 
+VEC8D_AGNER
+ - Double precision
+ - Vector length of 8
+ - Use Agner's vectorclass with AVX512 intrinisics
+
+VEC16F_AGNER
+ - Single precision
+ - Vector length of 16
+ - Use Agner's vectorclass with AVX512 intrinisics
+
+VEC4D_FALLBACK, VEC4F_FALLBACK, VEC8D_FALLBACK, VEC8F_FALLBACK, VEC16F_FALLBACK
+ - Portable element-wise implementation in vectorclass_fallback.h,
+   the reference for the other backends
+
+VEC4D_STDSIMD, VEC4F_STDSIMD, VEC8D_STDSIMD, VEC8F_STDSIMD, VEC16F_STDSIMD
+ - Portable implementation on std::experimental::simd (C++17 Parallelism
+   TS v2, e.g. GCC >= 11) in vectorclass_stdsimd.h
+ - Vectorised for the target of the compiler, e.g., AVX-512 with
+   VEC8D/VEC16F or ARM SVE with -msve-vector-bits=512
+ - Bitwise identical results to the fallback of the same length and
+   precision, checked by mini-apps/vectorclass-test
+
+Mixed precision
+ - Double precision vector (VEC4D_* or VEC8D_*) without -DDPF
+ - The distribution function is stored in single precision (Realf),
+   while intersections and reconstructions are computed in double
+   precision (Realv). VEC_MIXED_PRECISION is defined in this case,
+   loads and stores of block data then convert between the two.
+
  
 */
 
@@ -189,6 +218,97 @@ typedef float Realv;
 #define VEC_PER_BLOCK 8
 #endif
 
+#ifdef VEC16F_FALLBACK
+//user portable vectorclass
+#include "vectorclass_fallback.h"
+typedef Vec16Simple<float> Vec;
+typedef Vec16Simple<bool> Vecb;
+typedef Vec16Simple<int> Veci;
+typedef float Realv;
+#define to_realv(v) to_float(v)
+#define VECL 16
+#define VPREC 4
+#define VEC_PER_PLANE 1 //vectors per plane in block
+#define VEC_PER_BLOCK 4
+#endif
+
+
+
+#ifdef VEC4D_STDSIMD
+//user std::experimental::simd, double precision accuracy
+#include "vectorclass_stdsimd.h"
+typedef VecSimd<double,4> Vec;
+typedef VecSimdb<double,4> Vecb;
+typedef VecSimd<int,4> Veci;
+typedef double Realv;
+#define to_realv(v) to_double(v)
+#define VECL 4
+#define VPREC 8
+#define VEC_PER_PLANE 4 //vectors per plane in block
+#define VEC_PER_BLOCK 16
+#endif
+
+#ifdef VEC4F_STDSIMD
+//user std::experimental::simd, single precision accuracy
+#include "vectorclass_stdsimd.h"
+typedef VecSimd<float,4> Vec;
+typedef VecSimdb<float,4> Vecb;
+typedef VecSimd<int,4> Veci;
+typedef float Realv;
+#define to_realv(v) to_float(v)
+#define VECL 4
+#define VPREC 4
+#define VEC_PER_PLANE 4 //vectors per plane in block
+#define VEC_PER_BLOCK 16
+#endif
+
+#ifdef VEC8D_STDSIMD
+//user std::experimental::simd, double precision accuracy
+#include "vectorclass_stdsimd.h"
+typedef VecSimd<double,8> Vec;
+typedef VecSimdb<double,8> Vecb;
+typedef VecSimd<int,8> Veci;
+typedef double Realv;
+#define to_realv(v) to_double(v)
+#define VECL 8
+#define VPREC 8
+#define VEC_PER_PLANE 2 //vectors per plane in block
+#define VEC_PER_BLOCK 8
+#endif
+
+#ifdef VEC8F_STDSIMD
+//user std::experimental::simd, single precision accuracy
+#include "vectorclass_stdsimd.h"
+typedef VecSimd<float,8> Vec;
+typedef VecSimdb<float,8> Vecb;
+typedef VecSimd<int,8> Veci;
+typedef float Realv;
+#define to_realv(v) to_float(v)
+#define VECL 8
+#define VPREC 4
+#define VEC_PER_PLANE 2 //vectors per plane in block
+#define VEC_PER_BLOCK 8
+#endif
+
+#ifdef VEC16F_STDSIMD
+//user std::experimental::simd, single precision accuracy
+#include "vectorclass_stdsimd.h"
+typedef VecSimd<float,16> Vec;
+typedef VecSimdb<float,16> Vecb;
+typedef VecSimd<int,16> Veci;
+typedef float Realv;
+#define to_realv(v) to_float(v)
+#define VECL 16
+#define VPREC 4
+#define VEC_PER_PLANE 1 //vectors per plane in block
+#define VEC_PER_BLOCK 4
+#endif
+
+// Block data stored in single precision, computations in double precision
+#if VPREC == 8 && !defined(DPF)
+#define VEC_MIXED_PRECISION
+#endif
+
 
 const Vec one(1.0);
 const Vec minus_one(-1.0);
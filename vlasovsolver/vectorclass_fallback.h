@@ -640,7 +640,7 @@ static inline Vec4Simple<float> to_float(Vec4Simple<T> const & a){
 
 // Dummy functions that Agner vectorclass has.
 // These are here to suppress compiler error messages only
-static void no_subnormals() 
+static inline void no_subnormals()
 {
 }
 
@@ -1465,4 +1465,487 @@ static inline Vec8Simple<float> to_float(Vec8Simple<T> const & a){
 }
 
 
+/* Vector of 16 values, used by VEC16F_FALLBACK. The operations are
+   written as loops over the elements, the results are identical to
+   those of Vec4Simple and Vec8Simple element by element.*/
+template <class T>
+class Vec16Simple {
+public:
+   T val[16] __attribute__((aligned(64)));
+   // donot initi v
+   Vec16Simple() { }
+   // Replicate scalar x across v.
+   Vec16Simple(T x){
+      for(unsigned int i=0; i<16; i++)
+         val[i]=x;
+   }
+
+   // Replicate 16 values across v.
+   Vec16Simple(T a,T b,T c,T d, T e,T f,T g,T h,
+               T i,T j,T k,T l, T m,T n,T o,T p){
+      val[0]=a;  val[1]=b;  val[2]=c;  val[3]=d;
+      val[4]=e;  val[5]=f;  val[6]=g;  val[7]=h;
+      val[8]=i;  val[9]=j;  val[10]=k; val[11]=l;
+      val[12]=m; val[13]=n; val[14]=o; val[15]=p;
+   }
+   // Copy vector v.
+   Vec16Simple(Vec16Simple const &x){
+      for(unsigned int i=0;i<16;i++)
+         val[i]=x.val[i];
+   }
+
+   // Member function to load from array (unaligned)
+   Vec16Simple & load(T const * p)  {
+      for(unsigned int i=0;i<16;i++)
+         val[i]=p[i];
+      return *this;
+   }
+   // Member function to load from array, aligned by 64
+   Vec16Simple & load_a(T const * p){
+      return this->load(p);
+   }
+
+   Vec16Simple & insert(int i,T const &x) {
+      val[i]=x;
+      return *this;
+   }
+
+   // Member function to store into array (unaligned)
+   void store(T * p) const {
+      for(unsigned int i=0;i<16;i++)
+         p[i]=val[i];
+   }
+   // Member function to store into array, aligned by 64
+   void store_a(T * p) const {
+      this->store(p);
+   }
+
+   Vec16Simple & operator = (Vec16Simple const & r){
+      for(unsigned int i=0;i<16;i++)
+         val[i]=r.val[i];
+      return *this;
+   }
+
+   T operator [](int i) const{
+      return val[i];
+   }
+
+   Vec16Simple operator++ (int)
+   {
+      Vec16Simple<T> temp (*this);
+      for(unsigned int i=0;i<16;i++)
+         val[i]++;
+      return temp;
+   }
+};
+
+template <class T>
+static inline Vec16Simple<T> abs(const Vec16Simple<T> &l) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = fabs(l.val[i]);
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> sqrt(const Vec16Simple<T> &l) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = sqrt(l.val[i]);
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> operator + (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]+r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator + (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l+r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator + (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]+r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> operator - (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]-r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator - (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l-r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator - (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]-r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> operator - (const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = -r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> operator * (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]*r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator * (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l*r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator * (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]*r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> operator / (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]/r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator / (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l/r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> operator / (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]/r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> & operator += (Vec16Simple<T> &l, const Vec16Simple<T> &r){
+   l=l+r;
+   return l;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> & operator += (Vec16Simple<T> &l, const S &r){
+   l=l+r;
+   return l;
+}
+
+template <class T>
+static inline Vec16Simple<T> & operator -= (Vec16Simple<T> &l, const Vec16Simple<T> &r){
+   l=l-r;
+   return l;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> & operator -= (Vec16Simple<T> &l, const S &r){
+   l=l-r;
+   return l;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator || (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] || r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator && (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] && r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator ! (const Vec16Simple<T> &l) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = !l.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator == (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] == r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator == (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] == r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator != (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] != r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator != (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] != r;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator > (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] > r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator > (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] > r;
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator > (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l > r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator >= (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] >= r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator >= (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] >= r;
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator >= (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l >= r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator < (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] < r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator < (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] < r;
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator < (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l < r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<bool> operator <= (const Vec16Simple<T> &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] <= r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator <= (const Vec16Simple<T> &l, const S &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] <= r;
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<bool> operator <= (const S &l, const Vec16Simple<T> &r) {
+   Vec16Simple<bool> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l <= r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> min(Vec16Simple<T> const & l, Vec16Simple<T> const & r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]<r.val[i]?l.val[i]:r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> min(S const & l, Vec16Simple<T> const & r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l<r.val[i]?l:r.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> max(Vec16Simple<T> const & l, Vec16Simple<T> const & r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i]>r.val[i]?l.val[i]:r.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> max(Vec16Simple<T> const & l, S const & r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = l.val[i] > r ? l.val[i] : r;
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> max(S const & l, Vec16Simple<T> const & r) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = r.val[i] > l ? r.val[i] : l;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> select(Vec16Simple<bool> const & a, Vec16Simple<T> const & b, Vec16Simple<T> const & c) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i] ? b.val[i] : c.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> select(Vec16Simple<bool> const & a, S const & b, Vec16Simple<T> const & c) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i] ? b : c.val[i];
+   return result;
+}
+
+template <class T, class S>
+static inline Vec16Simple<T> select(Vec16Simple<bool> const & a, Vec16Simple<T> const & b, S const & c) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i] ? b.val[i] : c;
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<T> select(Vec16Simple<bool> const & a, T const & b, T const & c) {
+   Vec16Simple<T> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i] ? b : c;
+   return result;
+}
+
+template <class T>
+static inline bool horizontal_or(Vec16Simple<T> const & a){
+   bool result = false;
+   for(unsigned int i=0;i<16;i++)
+      result = result || a.val[i];
+   return result;
+}
+
+template <class T>
+static inline bool horizontal_and(Vec16Simple<T> const & a){
+   bool result = true;
+   for(unsigned int i=0;i<16;i++)
+      result = result && a.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<int> truncate_to_int(Vec16Simple<T> const & a) {
+   Vec16Simple<int> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<double> to_double(Vec16Simple<T> const & a) {
+   Vec16Simple<double> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i];
+   return result;
+}
+
+template <class T>
+static inline Vec16Simple<float> to_float(Vec16Simple<T> const & a) {
+   Vec16Simple<float> result;
+   for(unsigned int i=0;i<16;i++)
+      result.val[i] = a.val[i];
+   return result;
+}
+
+
 #endif
@@ -0,0 +1,327 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef VECTORCLASS_STDSIMD_H
+#define VECTORCLASS_STDSIMD_H
+
+#include <type_traits>
+#include <experimental/simd>
+
+/*! \file vectorclass_stdsimd.h
+  \brief Vector of N values implemented with std::experimental::simd
+
+  Portable vector backend for the architectures Agner's vectorclass does
+  not support, e.g., ARM SVE, and for AVX-512 without vectorclass. The
+  interface is that of vectorclass_fallback.h, and the results are
+  bitwise identical to it: an operation between a vector and a scalar
+  is evaluated in the promoted type of the two, as the element-wise
+  fallback does, before it is converted back to the type of the vector.
+*/
+
+// Prefetching does nothing in the std::simd vectorclass, if no system
+// implementation is available
+#ifndef _mm_prefetch
+#define _mm_prefetch(...)
+#endif
+
+namespace stdx = std::experimental;
+
+template <class T, int N>
+class VecSimd;
+
+/** Mask of N values, the result of comparing two VecSimd.*/
+template <class T, int N>
+class VecSimdb {
+public:
+   typedef stdx::fixed_size_simd_mask<T,N> mask_type;
+   mask_type m;
+   VecSimdb() { }
+   VecSimdb(bool x) : m(x) { }
+   VecSimdb(const mask_type& x) : m(x) { }
+   // Masks of vectors of another type but of the same length convert
+   template <class U>
+   VecSimdb(const VecSimdb<U,N>& x) : m(x.m) { }
+
+   bool operator [](int i) const{
+      return m[i];
+   }
+};
+
+template <class T, int N>
+class VecSimd {
+public:
+   typedef stdx::fixed_size_simd<T,N> simd_type;
+   simd_type v;
+   // donot initi v
+   VecSimd() { }
+   // Replicate scalar x across v.
+   VecSimd(T x) : v(x) { }
+   VecSimd(const simd_type& x) : v(x) { }
+
+   // Set all N values of v.
+   template <class... S, typename = std::enable_if_t<sizeof...(S) == N && (N > 1)> >
+   VecSimd(S... x) {
+      const T values[N] = {static_cast<T>(x)...};
+      v.copy_from(values, stdx::element_aligned);
+   }
+
+   // Member function to load from array (unaligned)
+   VecSimd & load(T const * p)  {
+      v.copy_from(p, stdx::element_aligned);
+      return *this;
+   }
+   // Member function to load from array, aligned by the vector length
+   VecSimd & load_a(T const * p){
+      return this->load(p);
+   }
+
+   VecSimd & insert(int i,T const &x) {
+      v[i]=x;
+      return *this;
+   }
+
+   // Member function to store into array (unaligned)
+   void store(T * p) const {
+      v.copy_to(p, stdx::element_aligned);
+   }
+   // Member function to store into array, aligned by the vector length
+   void store_a(T * p) const {
+      this->store(p);
+   }
+
+   T operator [](int i) const{
+      return v[i];
+   }
+
+   VecSimd operator++ (int)
+   {
+      VecSimd<T,N> temp (*this);
+      ++v;
+      return temp;
+   }
+};
+
+/** Promoted type of an operation between a vector of T and a scalar of S.*/
+template <class T, class S>
+using vecsimd_promoted_t = decltype(std::declval<T>() + std::declval<S>());
+
+/** Convert the vector to the promoted type of T and S, a no-op if they agree.*/
+template <class T, class S, int N>
+static inline stdx::fixed_size_simd<vecsimd_promoted_t<T,S>,N> vecsimd_promote(const stdx::fixed_size_simd<T,N>& x){
+   return stdx::static_simd_cast<stdx::fixed_size_simd<vecsimd_promoted_t<T,S>,N> >(x);
+}
+
+/** Convert the vector back to a vector of T, a no-op if the types agree.*/
+template <class T, class U, int N>
+static inline VecSimd<T,N> vecsimd_demote(const stdx::fixed_size_simd<U,N>& x){
+   return VecSimd<T,N>(stdx::static_simd_cast<stdx::fixed_size_simd<T,N> >(x));
+}
+
+template <class T, int N>
+static inline VecSimd<T,N> abs(const VecSimd<T,N> &l){
+   return VecSimd<T,N>(stdx::abs(l.v));
+}
+
+template <class T, int N>
+static inline VecSimd<T,N> sqrt(const VecSimd<T,N> &l){
+   return VecSimd<T,N>(stdx::sqrt(l.v));
+}
+
+/* Arithmetic operators between two vectors, and between a vector and a
+   scalar in either order.*/
+#define VECSIMD_ARITHMETIC_OPERATOR(OP)                                  \
+template <class T, int N>                                               \
+static inline VecSimd<T,N> operator OP (const VecSimd<T,N> &l, const VecSimd<T,N> &r){ \
+   return VecSimd<T,N>(l.v OP r.v);                                     \
+}                                                                       \
+template <class T, int N, class S>                                      \
+static inline VecSimd<T,N> operator OP (const S &l, const VecSimd<T,N> &r){ \
+   typedef vecsimd_promoted_t<T,S> R;                                   \
+   return vecsimd_demote<T>(stdx::fixed_size_simd<R,N>(static_cast<R>(l)) OP vecsimd_promote<T,S>(r.v)); \
+}                                                                       \
+template <class T, int N, class S>                                      \
+static inline VecSimd<T,N> operator OP (const VecSimd<T,N> &l, const S &r){ \
+   typedef vecsimd_promoted_t<T,S> R;                                   \
+   return vecsimd_demote<T>(vecsimd_promote<T,S>(l.v) OP stdx::fixed_size_simd<R,N>(static_cast<R>(r))); \
+}
+
+VECSIMD_ARITHMETIC_OPERATOR(+)
+VECSIMD_ARITHMETIC_OPERATOR(-)
+VECSIMD_ARITHMETIC_OPERATOR(*)
+VECSIMD_ARITHMETIC_OPERATOR(/)
+#undef VECSIMD_ARITHMETIC_OPERATOR
+
+template <class T, int N>
+static inline VecSimd<T,N> operator - (const VecSimd<T,N> &r){
+   return VecSimd<T,N>(-r.v);
+}
+
+template <class T, int N>
+static inline VecSimd<T,N> & operator += (VecSimd<T,N> &l, const VecSimd<T,N> &r){
+   l.v += r.v;
+   return l;
+}
+
+template <class T, int N, class S>
+static inline VecSimd<T,N> & operator += (VecSimd<T,N> &l, const S &r){
+   l = l + r;
+   return l;
+}
+
+template <class T, int N>
+static inline VecSimd<T,N> & operator -= (VecSimd<T,N> &l, const VecSimd<T,N> &r){
+   l.v -= r.v;
+   return l;
+}
+
+template <class T, int N, class S>
+static inline VecSimd<T,N> & operator -= (VecSimd<T,N> &l, const S &r){
+   l = l - r;
+   return l;
+}
+
+template <class T, int N>
+static inline VecSimdb<T,N> operator || (const VecSimdb<T,N> &l, const VecSimdb<T,N> &r){
+   return VecSimdb<T,N>(l.m || r.m);
+}
+
+template <class T, int N>
+static inline VecSimdb<T,N> operator && (const VecSimdb<T,N> &l, const VecSimdb<T,N> &r){
+   return VecSimdb<T,N>(l.m && r.m);
+}
+
+template <class T, int N>
+static inline VecSimdb<T,N> operator ! (const VecSimdb<T,N> &l){
+   return VecSimdb<T,N>(!l.m);
+}
+
+/* Comparison operators between two vectors, and between a vector and a
+   scalar in either order.*/
+#define VECSIMD_COMPARISON_OPERATOR(OP)                                  \
+template <class T, int N>                                               \
+static inline VecSimdb<T,N> operator OP (const VecSimd<T,N> &l, const VecSimd<T,N> &r){ \
+   return VecSimdb<T,N>(l.v OP r.v);                                    \
+}                                                                       \
+template <class T, int N, class S>                                      \
+static inline VecSimdb<T,N> operator OP (const S &l, const VecSimd<T,N> &r){ \
+   typedef vecsimd_promoted_t<T,S> R;                                   \
+   return VecSimdb<R,N>(stdx::fixed_size_simd<R,N>(static_cast<R>(l)) OP vecsimd_promote<T,S>(r.v)); \
+}                                                                       \
+template <class T, int N, class S>                                      \
+static inline VecSimdb<T,N> operator OP (const VecSimd<T,N> &l, const S &r){ \
+   typedef vecsimd_promoted_t<T,S> R;                                   \
+   return VecSimdb<R,N>(vecsimd_promote<T,S>(l.v) OP stdx::fixed_size_simd<R,N>(static_cast<R>(r))); \
+}
+
+VECSIMD_COMPARISON_OPERATOR(==)
+VECSIMD_COMPARISON_OPERATOR(!=)
+VECSIMD_COMPARISON_OPERATOR(>)
+VECSIMD_COMPARISON_OPERATOR(>=)
+VECSIMD_COMPARISON_OPERATOR(<)
+VECSIMD_COMPARISON_OPERATOR(<=)
+#undef VECSIMD_COMPARISON_OPERATOR
+
+template <class T, int N, class U>
+static inline VecSimd<T,N> select(VecSimdb<U,N> const & a, VecSimd<T,N> const & b, VecSimd<T,N> const & c){
+   VecSimd<T,N> result(c);
+   stdx::where(typename VecSimdb<T,N>::mask_type(a.m), result.v) = b.v;
+   return result;
+}
+
+template <class T, int N, class U, class S>
+static inline VecSimd<T,N> select(VecSimdb<U,N> const & a, S const & b, VecSimd<T,N> const & c){
+   return select(a, VecSimd<T,N>(static_cast<T>(b)), c);
+}
+
+template <class T, int N, class U, class S>
+static inline VecSimd<T,N> select(VecSimdb<U,N> const & a, VecSimd<T,N> const & b, S const & c){
+   return select(a, b, VecSimd<T,N>(static_cast<T>(c)));
+}
+
+// min and max pick the second argument also when the comparison is false
+// because of a NaN, as the fallback does
+template <class T, int N>
+static inline VecSimd<T,N> min(VecSimd<T,N> const & l, VecSimd<T,N> const & r){
+   return select(l < r, l, r);
+}
+
+template <class T, int N, class S>
+static inline VecSimd<T,N> min(S const & l, VecSimd<T,N> const & r){
+   return select(l < r, l, r);
+}
+
+template <class T, int N>
+static inline VecSimd<T,N> max(VecSimd<T,N> const & l, VecSimd<T,N> const & r){
+   return select(l > r, l, r);
+}
+
+template <class T, int N, class S>
+static inline VecSimd<T,N> max(VecSimd<T,N> const & l, S const & r){
+   return select(l > r, l, r);
+}
+
+template <class T, int N, class S>
+static inline VecSimd<T,N> max(S const & l, VecSimd<T,N> const & r){
+   return select(r > l, r, l);
+}
+
+template <class T, int N>
+static inline bool horizontal_or(VecSimdb<T,N> const & a){
+   return stdx::any_of(a.m);
+}
+
+template <class T, int N>
+static inline bool horizontal_and(VecSimdb<T,N> const & a){
+   return stdx::all_of(a.m);
+}
+
+template <class T, int N>
+static inline bool horizontal_or(VecSimd<T,N> const & a){
+   return stdx::any_of(a.v != T(0));
+}
+
+template <class T, int N>
+static inline bool horizontal_and(VecSimd<T,N> const & a){
+   return stdx::all_of(a.v != T(0));
+}
+
+template <class T, int N>
+static inline VecSimd<int,N> truncate_to_int(VecSimd<T,N> const & a){
+   return vecsimd_demote<int>(a.v);
+}
+
+template <class T, int N>
+static inline VecSimd<double,N> to_double(VecSimd<T,N> const & a){
+   return vecsimd_demote<double>(a.v);
+}
+
+template <class T, int N>
+static inline VecSimd<float,N> to_float(VecSimd<T,N> const & a){
+   return vecsimd_demote<float>(a.v);
+}
+
+// Dummy functions that Agner vectorclass has.
+// These are here to suppress compiler error messages only
+static inline void no_subnormals()
+{
+}
+
+#endif
@@ -40,6 +40,7 @@
 #include "../mpiconversion.h"
 
 #include "cpu_moments.h"
+#include "cpu_acc_map.hpp"
 #include "cpu_acc_semilag.hpp"
 #include "cpu_trans_map.hpp"
 #include "cpu_trans_map_amr.hpp"
@@ -55,167 +56,150 @@ creal ONE     = 1.0;
 creal TWO     = 2.0;
 creal EPSILON = 1.0e-25;
 
-/** Propagates the distribution function in spatial space. 
-    
-    Based on SLICE-3D algorithm: Zerroukat, M., and T. Allen. "A
-    three‐dimensional monotone and conservative semi‐Lagrangian scheme
-    (SLICE‐3D) for transport problems." Quarterly Journal of the Royal
-    Meteorological Society 138.667 (2012): 1640-1651.
-  
+/* Translate in one dimension with AMR, propagating the interior pencils (see
+ * classifyInteriorPencils) while the stencil data of the remote cells is being
+ * transferred, and the boundary pencils after the transfer has completed.
  */
-void calculateSpatialTranslation(
+static void trans_map_1d_amr_overlapped(
         dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-        const vector<CellID>& localCells,
         const vector<CellID>& local_propagated_cells,
-        const vector<CellID>& local_target_cells,
-        const vector<CellID>& remoteTargetCellsx,
-        const vector<CellID>& remoteTargetCellsy,
-        const vector<CellID>& remoteTargetCellsz,
+        const vector<CellID>& remoteTargetCells,
         vector<uint>& nPencils,
+        const uint dimension,
+        const int neighborhood,
         creal dt,
         const uint popID,
         Real &time
 ) {
+   const string direction(1, "xyz"[dimension]);
+
+   phiprof::Timer transTimer {"start-transfer-stencil-data-"+direction, {"MPI"}};
+   SpatialCell::set_mpi_transfer_direction(dimension);
+   SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA,false,true);
+   mpiGrid.start_remote_neighbor_copy_updates(neighborhood);
+   transTimer.stop();
+
+   double t1 = MPI_Wtime();
+   phiprof::Timer interiorTimer {"compute-mapping-interior-"+direction};
+   trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCells, nPencils, dimension, dt, popID, INTERIOR_PENCILS);
+   interiorTimer.stop();
+   time += MPI_Wtime() - t1;
+
+   phiprof::Timer waitTimer {"wait-stencil-data-"+direction, {"MPI","Wait"}};
+   mpiGrid.wait_remote_neighbor_copy_updates(neighborhood);
+   waitTimer.stop();
+
+   t1 = MPI_Wtime();
+   phiprof::Timer boundaryTimer {"compute-mapping-boundary-"+direction};
+   trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCells, nPencils, dimension, dt, popID, BOUNDARY_PENCILS);
+   boundaryTimer.stop();
+   time += MPI_Wtime() - t1;
+}
 
-    bool AMRtranslationActive = false;
-    if (P::amrMaxSpatialRefLevel > 0) AMRtranslationActive = true;
-
-    double t1;
-    
-    int myRank;
-    MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
-   
-   phiprof::Timer btzTimer {"barrier-trans-pre-z", {"Barriers","MPI"}};
-   MPI_Barrier(MPI_COMM_WORLD);
-   btzTimer.stop();
- 
-    // ------------- SLICE - map dist function in Z --------------- //
-   if(P::zcells_ini > 1){
-
-      phiprof::Timer transTimer {"transfer-stencil-data-z", {"MPI"}};
-      //updateRemoteVelocityBlockLists(mpiGrid,popID,VLASOV_SOLVER_Z_NEIGHBORHOOD_ID);
-      SpatialCell::set_mpi_transfer_direction(2);
+/* Translate in one dimension: update the stencil data of the remote cells,
+ * map the local cells, and add the contributions of the neighboring processes
+ * to the local cells.
+ */
+static void translateDimension(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& local_propagated_cells,
+        const vector<CellID>& remoteTargetCells,
+        vector<uint>& nPencils,
+        const uint dimension,
+        creal dt,
+        const uint popID,
+        Real &time
+) {
+   const bool AMRtranslationActive = (P::amrMaxSpatialRefLevel > 0);
+   const int neighborhoods[3] = {VLASOV_SOLVER_X_NEIGHBORHOOD_ID, VLASOV_SOLVER_Y_NEIGHBORHOOD_ID, VLASOV_SOLVER_Z_NEIGHBORHOOD_ID};
+   const int neighborhood = neighborhoods[dimension];
+   const string direction(1, "xyz"[dimension]);
+
+   if (AMRtranslationActive && P::vlasovTranslationOverlap) {
+      trans_map_1d_amr_overlapped(mpiGrid, local_propagated_cells, remoteTargetCells, nPencils, dimension,
+                                  neighborhood, dt, popID, time);
+   } else {
+      phiprof::Timer transTimer {"transfer-stencil-data-"+direction, {"MPI"}};
+      //updateRemoteVelocityBlockLists(mpiGrid,popID,neighborhood);
+      // With AMR only the cells flagged by flagSpatialCellsForAmrCommunication, i.e. the
+      // stencil slab of the pencils of the receiving process, are sent. The fluxes out of
+      // the local pencils are returned by update_remote_mapping_contribution_amr.
+      SpatialCell::set_mpi_transfer_direction(dimension);
       SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA,false,AMRtranslationActive);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_Z_NEIGHBORHOOD_ID);
+      mpiGrid.update_copies_of_remote_neighbors(neighborhood);
       transTimer.stop();
 
-      // bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-z","Barriers","MPI");
-      // phiprof::start(bt);
-      // MPI_Barrier(MPI_COMM_WORLD);
-      // phiprof::stop(bt);
-
-      t1 = MPI_Wtime();
-      phiprof::Timer computeTimer {"compute-mapping-z"};
+      double t1 = MPI_Wtime();
+      phiprof::Timer computeTimer {"compute-mapping-"+direction};
       if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsz, 2, dt,popID); // map along z//
+         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCells, dimension, dt,popID);
       } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsz, nPencils, 2, dt,popID); // map along z//
+         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCells, nPencils, dimension, dt,popID);
       }
       computeTimer.stop();
       time += MPI_Wtime() - t1;
-
-      phiprof::Timer btTimer {"barrier-trans-pre-update_remote-z", {"Barriers","MPI"}};
-      MPI_Barrier(MPI_COMM_WORLD);
-      btTimer.stop();
-
-      phiprof::Timer updateRemoteTimer {"update_remote-z", {"MPI"}};
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 2,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 2,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 2,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 2,-1,popID);
-      }
-      updateRemoteTimer.stop();
-
    }
 
-   phiprof::Timer btxTimer {"barrier-trans-pre-x", {"Barriers","MPI"}};
+   phiprof::Timer btTimer {"barrier-trans-pre-update_remote-"+direction, {"Barriers","MPI"}};
    MPI_Barrier(MPI_COMM_WORLD);
-   btxTimer.stop();
-   
-   // ------------- SLICE - map dist function in X --------------- //
-   if(P::xcells_ini > 1){
-      
-      phiprof::Timer transTimer {"transfer-stencil-data-x", {"MPI"}};
-      //updateRemoteVelocityBlockLists(mpiGrid,popID,VLASOV_SOLVER_X_NEIGHBORHOOD_ID);
-      SpatialCell::set_mpi_transfer_direction(0);
-      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA,false,AMRtranslationActive);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_X_NEIGHBORHOOD_ID);
-      transTimer.stop();
-      
-      // bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-x","Barriers","MPI");
-      // phiprof::start(bt);
-      // MPI_Barrier(MPI_COMM_WORLD);
-      // phiprof::stop(bt);
+   btTimer.stop();
 
-      t1 = MPI_Wtime();
-      phiprof::Timer computeTimer {"compute-mapping-x"};
-      if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsx, 0,dt,popID); // map along x//
-      } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsx, nPencils, 0,dt,popID); // map along x//
-      }
-      computeTimer.stop();
-      time += MPI_Wtime() - t1;
+   phiprof::Timer updateRemoteTimer {"update_remote-"+direction, {"MPI"}};
+   if(P::amrMaxSpatialRefLevel == 0) {
+      update_remote_mapping_contribution(mpiGrid, dimension,+1,popID);
+      update_remote_mapping_contribution(mpiGrid, dimension,-1,popID);
+   } else {
+      update_remote_mapping_contribution_amr(mpiGrid, dimension,+1,popID);
+      update_remote_mapping_contribution_amr(mpiGrid, dimension,-1,popID);
+   }
+   updateRemoteTimer.stop();
+}
 
-      phiprof::Timer btTimer {"barrier-trans-pre-update_remote-x", {"Barriers","MPI"}};
-      MPI_Barrier(MPI_COMM_WORLD);
-      btTimer.stop();
+/** Propagates the distribution function in spatial space. 
+    
+    Based on SLICE-3D algorithm: Zerroukat, M., and T. Allen. "A
+    three‐dimensional monotone and conservative semi‐Lagrangian scheme
+    (SLICE‐3D) for transport problems." Quarterly Journal of the Royal
+    Meteorological Society 138.667 (2012): 1640-1651.
 
-      phiprof::Timer updateRemoteTimer {"update_remote-x", {"MPI"}};
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 0,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 0,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 0,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 0,-1,popID);
-      }
-      updateRemoteTimer.stop();
+    The dimensions are mapped in the order z, x, y. With
+    vlasovsolver.translationStrang the order is reversed to y, x, z on every
+    other time step, which makes the splitting error second order over a pair
+    of time steps.
+ */
+void calculateSpatialTranslation(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& localCells,
+        const vector<CellID>& local_propagated_cells,
+        const vector<CellID>& local_target_cells,
+        const vector<CellID>& remoteTargetCellsx,
+        const vector<CellID>& remoteTargetCellsy,
+        const vector<CellID>& remoteTargetCellsz,
+        vector<uint>& nPencils,
+        creal dt,
+        const uint popID,
+        Real &time
+) {
+   const vector<CellID>* remoteTargetCells[3] = {&remoteTargetCellsx, &remoteTargetCellsy, &remoteTargetCellsz};
+   const uint cells_ini[3] = {P::xcells_ini, P::ycells_ini, P::zcells_ini};
+   uint order[3] = {2, 0, 1};
+   if (P::vlasovTranslationStrang && P::tstep % 2 == 1) {
+      order[0] = 1;
+      order[2] = 2;
    }
 
-   phiprof::Timer btyTimer {"barrier-trans-pre-y", {"Barriers","MPI"}};
-   MPI_Barrier(MPI_COMM_WORLD);
-   btyTimer.stop();
-
-   // ------------- SLICE - map dist function in Y --------------- //
-   if(P::ycells_ini > 1) {
-      
-      phiprof::Timer transTimer {"transfer-stencil-data-y", {"MPI"}};
-      //updateRemoteVelocityBlockLists(mpiGrid,popID,VLASOV_SOLVER_Y_NEIGHBORHOOD_ID);
-      SpatialCell::set_mpi_transfer_direction(1);
-      SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_DATA,false,AMRtranslationActive);
-      mpiGrid.update_copies_of_remote_neighbors(VLASOV_SOLVER_Y_NEIGHBORHOOD_ID);
-      transTimer.stop();
-      
-      // bt=phiprof::initializeTimer("barrier-trans-pre-trans_map_1d-y","Barriers","MPI");
-      // phiprof::start(bt);
-      // MPI_Barrier(MPI_COMM_WORLD);
-      // phiprof::stop(bt);
+   for (uint d = 0; d < 3; ++d) {
+      const uint dimension = order[d];
 
-      t1 = MPI_Wtime();
-      phiprof::Timer computeTimer {"compute-mapping-y"};
-      if(P::amrMaxSpatialRefLevel == 0) {
-         trans_map_1d(mpiGrid,local_propagated_cells, remoteTargetCellsy, 1,dt,popID); // map along y//
-      } else {
-         trans_map_1d_amr(mpiGrid,local_propagated_cells, remoteTargetCellsy, nPencils, 1,dt,popID); // map along y//      
-      }
-      computeTimer.stop();
-      time += MPI_Wtime() - t1;
-      
-      phiprof::Timer btTimer {"barrier-trans-pre-update_remote-y", {"Barriers","MPI"}};
+      phiprof::Timer btTimer {string("barrier-trans-pre-") + "xyz"[dimension], {"Barriers","MPI"}};
       MPI_Barrier(MPI_COMM_WORLD);
       btTimer.stop();
 
-      phiprof::Timer updateRemoteTimer {"update_remote-y", {"MPI"}};
-      if(P::amrMaxSpatialRefLevel == 0) {
-         update_remote_mapping_contribution(mpiGrid, 1,+1,popID);
-         update_remote_mapping_contribution(mpiGrid, 1,-1,popID);
-      } else {
-         update_remote_mapping_contribution_amr(mpiGrid, 1,+1,popID);
-         update_remote_mapping_contribution_amr(mpiGrid, 1,-1,popID);
+      // ------------- SLICE - map dist function in this dimension --------------- //
+      if (cells_ini[dimension] > 1) {
+         translateDimension(mpiGrid, local_propagated_cells, *remoteTargetCells[dimension], nPencils, dimension,
+                            dt, popID, time);
       }
-      updateRemoteTimer.stop();
    }
 
    phiprof::Timer btpostimer {"barrier-trans-post-trans",{"Barriers","MPI"}};
@@ -261,6 +245,11 @@ void calculateSpatialTranslation(
       return;
    }
    
+   // Pencils are only rebuilt after load balancing or refinement
+   if (P::amrMaxSpatialRefLevel > 0) {
+      preparePencilsIfInvalid(mpiGrid);
+   }
+
    phiprof::Timer computeTimer {"compute_cell_lists"};
    remoteTargetCellsx = mpiGrid.get_remote_cells_on_process_boundary(VLASOV_SOLVER_TARGET_X_NEIGHBORHOOD_ID);
    remoteTargetCellsy = mpiGrid.get_remote_cells_on_process_boundary(VLASOV_SOLVER_TARGET_Y_NEIGHBORHOOD_ID);
@@ -311,23 +300,28 @@ void calculateSpatialTranslation(
    }
    
    if (Parameters::prepareForRebalance == true) {
-      if(P::amrMaxSpatialRefLevel == 0) {
-//          const double deltat = (MPI_Wtime() - t1) / local_propagated_cells.size();
-         for (size_t c=0; c<localCells.size(); ++c) {
-//            mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += time / localCells.size();
-            for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-               mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += mpiGrid[localCells[c]]->get_number_of_velocity_blocks(popID);
-            }
+      // Translation time of this process in ns is split between the cells
+      // in proportion to their number of blocks (times the number of
+      // pencils through them with AMR). normalizeLoadBalanceWeights
+      // converts the weights to blocks before the rebalance.
+      vector<Real> counters;
+      const vector<CellID>& weightedCells = (P::amrMaxSpatialRefLevel == 0) ? localCells : local_propagated_cells;
+      Real totalCounter = 0;
+      for (size_t c=0; c<weightedCells.size(); ++c) {
+         Real counter = 0;
+         for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+            counter += mpiGrid[weightedCells[c]]->get_number_of_velocity_blocks(popID);
          }
-      } else {
-//          const double deltat = MPI_Wtime() - t1;
-         for (size_t c=0; c<local_propagated_cells.size(); ++c) {
-            Real counter = 0;
-            for (uint popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-               counter += mpiGrid[local_propagated_cells[c]]->get_number_of_velocity_blocks(popID);
-            }
-            mpiGrid[local_propagated_cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += nPencils[c] * counter;
-//            mpiGrid[localCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += time / localCells.size();
+         if (P::amrMaxSpatialRefLevel != 0) {
+            counter *= nPencils[c];
+         }
+         counters.push_back(counter);
+         totalCounter += counter;
+      }
+      if (totalCounter > 0) {
+         const Real nsPerBlock = 1e9 * time / totalCounter;
+         for (size_t c=0; c<weightedCells.size(); ++c) {
+            mpiGrid[weightedCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += counters[c] * nsPerBlock;
          }
       }
    }
@@ -342,6 +336,29 @@ void calculateSpatialTranslation(
   --------------------------------------------------
 */
 
+/** Compute the length of the given acceleration subcycle step of a cell.
+ * The length is maxVdt on all steps except the last one. This is to keep
+ * the neighboring spatial cells in sync, so that two neighboring cells with
+ * different number of subcycles have similar timesteps, except that one
+ * takes an additional short step. This keeps spatial block neighbors as
+ * much in sync as possible for adjust blocks.
+ * @param cell Spatial cell.
+ * @param popID Particle population ID.
+ * @param step The current subcycle step.
+ * @param dt Timestep.
+ * @return Length of the subcycle step.*/
+static Real getSubcycleDt(const SpatialCell* cell,const uint popID,const uint step,const Real& dt) {
+   const Real maxVdt = cell->get_max_v_dt(popID);
+   Real subcycleDt;
+   if( (step + 1) * maxVdt > fabs(dt)) {
+      subcycleDt = max(fabs(dt) - step * maxVdt, 0.0);
+   } else{
+      subcycleDt = maxVdt;
+   }
+   if (dt<0) subcycleDt = -subcycleDt;
+   return subcycleDt;
+}
+
 /** Accelerate the given population to new time t+dt.
  * This function is AMR safe.
  * @param popID Particle population ID.
@@ -349,11 +366,13 @@ void calculateSpatialTranslation(
  * @param step The current subcycle step.
  * @param mpiGrid Parallel grid library.
  * @param propagatedCells List of cells in which the population is accelerated.
- * @param dt Timestep.*/
+ * @param dt Timestep.
+ * @param time Wall-clock time spent in the semi-Lagrangian acceleration is added here.*/
 void calculateAcceleration(const uint popID,const uint globalMaxSubcycles,const uint step,
                            dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                            const std::vector<CellID>& propagatedCells,
-                           const Real& dt) {
+                           const Real& dt,
+                           Real& time) {
    // Set active population
    SpatialCell::setCommunicatedSpecies(popID);
    
@@ -362,38 +381,25 @@ void calculateAcceleration(const uint popID,const uint globalMaxSubcycles,const
    // Calculated moments are stored in the "_V" variables.
    calculateMoments_V(mpiGrid, propagatedCells, false);
 
+   //generate pseudo-random order which is always the same irrespective of parallelization, restarts, etc.
+   std::default_random_engine rndState;
+   // set seed, initialise generator and get value. The order is the same
+   // for all cells, but varies with timestep.
+   rndState.seed(P::tstep);
+   const uint map_order=std::uniform_int_distribution<>(0,2)(rndState);
+
+   const double t1 = MPI_Wtime();
    // Semi-Lagrangian acceleration for those cells which are subcycled
    #pragma omp parallel for schedule(dynamic,1)
    for (size_t c=0; c<propagatedCells.size(); ++c) {
       const CellID cellID = propagatedCells[c];
-      const Real maxVdt = mpiGrid[cellID]->get_max_v_dt(popID);
-      
-      //compute subcycle dt. The length is maxVdt on all steps
-      //except the last one. This is to keep the neighboring
-      //spatial cells in sync, so that two neighboring cells with
-      //different number of subcycles have similar timesteps,
-      //except that one takes an additional short step. This keeps
-      //spatial block neighbors as much in sync as possible for
-      //adjust blocks.
-      Real subcycleDt;
-      if( (step + 1) * maxVdt > fabs(dt)) {
-	 subcycleDt = max(fabs(dt) - step * maxVdt, 0.0);
-      } else{
-         subcycleDt = maxVdt;
-      }
-      if (dt<0) subcycleDt = -subcycleDt;
-      
-      //generate pseudo-random order which is always the same irrespective of parallelization, restarts, etc.
-      std::default_random_engine rndState;
-      // set seed, initialise generator and get value. The order is the same
-      // for all cells, but varies with timestep.
-      rndState.seed(P::tstep);
+      const Real subcycleDt = getSubcycleDt(mpiGrid[cellID],popID,step,dt);
 
-      uint map_order=std::uniform_int_distribution<>(0,2)(rndState);
       phiprof::Timer semilagAccTimer {"cell-semilag-acc"};
       cpu_accelerate_cell(mpiGrid[cellID],popID,map_order,subcycleDt);
       semilagAccTimer.stop();
    }
+   time += MPI_Wtime() - t1;
 
    //global adjust after each subcycle to keep number of blocks managable. Even the ones not
    //accelerating anyore participate. It is important to keep
@@ -442,31 +448,74 @@ void calculateAcceleration(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
          // Iterate through all local cells and collect cells to propagate.
          // Ghost cells (spatial cells at the boundary of the simulation 
          // volume) do not need to be propagated:
-         vector<CellID> propagatedCells;
+         vector<CellID> candidateCells;
          for (size_t c=0; c<cells.size(); ++c) {
             SpatialCell* SC = mpiGrid[cells[c]];
-            const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = SC->get_velocity_mesh(popID);
             // disregard boundary cells, in preparation for acceleration
             if (  (SC->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) ||
                   // Include inflow-Maxwellian
                   (P::vlasovAccelerateMaxwellianBoundaries && (SC->sysBoundaryFlag == sysboundarytype::MAXWELLIAN)) ) {
-               if (vmesh.size() != 0){
-                  //do not propagate spatial cells with no blocks
-                  propagatedCells.push_back(cells[c]);
+               candidateCells.push_back(cells[c]);
+            }
+         }
+
+         // Populations which the transform only rotates around their isotropic
+         // bulk velocity are not propagated. The check needs the transform, so
+         // the "_V" moments have to be up to date.
+         vector<char> skipCell(candidateCells.size(),false);
+         uint skippedCells = 0;
+         if (P::vlasovAccelerationSkipIsotropic == true) {
+            phiprof::Timer skipTimer {"check-skip-acc"};
+            calculateMoments_V(mpiGrid, candidateCells, false);
+            #pragma omp parallel for schedule(dynamic,1) reduction(+:skippedCells)
+            for (size_t c=0; c<candidateCells.size(); ++c) {
+               SpatialCell* SC = mpiGrid[candidateCells[c]];
+               if (SC->get_velocity_mesh(popID).size() == 0) continue;
+               if (canSkipAcceleration(SC, popID, dt) == true) {
+                  skipCell[c] = true;
+                  ++skippedCells;
                }
-               //prepare for acceleration, updates max dt for each cell, it
-               //needs to be set to somthing sensible for _all_ cells, even if
-               //they are not propagated
-               prepareAccelerateCell(SC, popID);
-               //update max subcycles for all cells in this process
-               maxSubcycles = max((int)getAccelerationSubcycles(SC, dt, popID), maxSubcycles);
-               spatial_cell::Population& pop = SC->get_population(popID);
-               pop.ACCSUBCYCLES = getAccelerationSubcycles(SC, dt, popID);
             }
+            skipTimer.stop(skippedCells, "skipped cells");
+         }
+
+         vector<CellID> propagatedCells;
+         for (size_t c=0; c<candidateCells.size(); ++c) {
+            SpatialCell* SC = mpiGrid[candidateCells[c]];
+            const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = SC->get_velocity_mesh(popID);
+            //prepare for acceleration, updates max dt for each cell, it
+            //needs to be set to somthing sensible for _all_ cells, even if
+            //they are not propagated
+            prepareAccelerateCell(SC, popID);
+            spatial_cell::Population& pop = SC->get_population(popID);
+            if (skipCell[c] == true) {
+               pop.ACCSUBCYCLES = 0;
+               continue;
+            }
+            if (vmesh.size() != 0){
+               //do not propagate spatial cells with no blocks
+               propagatedCells.push_back(candidateCells[c]);
+            }
+            //update max subcycles for all cells in this process
+            maxSubcycles = max((int)getAccelerationSubcycles(SC, dt, popID), maxSubcycles);
+            pop.ACCSUBCYCLES = getAccelerationSubcycles(SC, dt, popID);
          }
 
          // Compute global maximum for number of subcycles
          MPI_Allreduce(&maxSubcycles, &globalMaxSubcycles, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+         // Acceleration time of this process is split between the
+         // accelerated cells in proportion to their blocks x subcycles,
+         // store cells and their blocks x subcycles
+         const vector<CellID> acceleratedCells = propagatedCells;
+         vector<Real> blockSubcycles;
+         if (P::prepareForRebalance == true) {
+            for (const auto& cell: acceleratedCells) {
+               blockSubcycles.push_back(mpiGrid[cell]->get_number_of_velocity_blocks(popID)
+                                        * mpiGrid[cell]->get_population(popID).ACCSUBCYCLES);
+            }
+         }
+         Real time = 0.0;
          
          // substep global max times
          for(uint step=0; step<(uint)globalMaxSubcycles; ++step) {
@@ -482,12 +531,35 @@ void calculateAcceleration(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
                propagatedCells.swap(temp);
             }
             // Accelerate population over one subcycle step
-            calculateAcceleration(popID,(uint)globalMaxSubcycles,step,mpiGrid,propagatedCells,dt);
+            calculateAcceleration(popID,(uint)globalMaxSubcycles,step,mpiGrid,propagatedCells,dt,time);
          } // for-loop over acceleration substeps
+
+         if (P::prepareForRebalance == true) {
+            Real totalBlockSubcycles = 0;
+            for (size_t c=0; c<acceleratedCells.size(); ++c) {
+               totalBlockSubcycles += blockSubcycles[c];
+            }
+            if (totalBlockSubcycles > 0) {
+               // average acceleration time per block and subcycle on this process, in ns
+               const Real nsPerBlock = 1e9 * time / totalBlockSubcycles;
+               for (size_t c=0; c<acceleratedCells.size(); ++c) {
+                  mpiGrid[acceleratedCells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += blockSubcycles[c] * nsPerBlock;
+               }
+            }
+         }
          
          // final adjust for all cells, also fixing remote cells.
          adjustVelocityBlocks(mpiGrid, cells, true, popID);
       } // for-loop over particle species
+
+      // Report the memory held by the per-thread scratch arenas of the 1D
+      // mappings whenever it has grown
+      static size_t reportedArenaBytes = 0;
+      if (getMap1dArenaBytes() > reportedArenaBytes) {
+         reportedArenaBytes = getMap1dArenaBytes();
+         logFile << "(ACC): Scratch arenas of the 1D mappings grew to " << reportedArenaBytes * 1e-6
+                 << " MB on this process" << endl << writeVerbose;
+      }
    }
 
    // Recalculate "_V" velocity moments